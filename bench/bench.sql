@@ -0,0 +1,189 @@
+--
+-- Throughput benchmark of the jsonlines format
+--
+-- Loads deterministic datasets and runs COPY TO and COPY FROM with the
+-- jsonlines format and the built-in text, csv and binary formats on the
+-- same data, printing one CSV line per dataset, format and direction:
+--
+--   label,dataset,format,direction,rows,bytes,seconds,mb_per_s,rows_per_s
+--
+-- 'bytes' is the size of the file, compressed for the gzip dataset, and the
+-- time is the best of 'iterations' runs.  The files are written by the
+-- server, so this needs a superuser and the server must be able to write to
+-- 'dir', where the files of the last run are left.  Run with "make bench" or
+-- "meson test --benchmark", or directly:
+--
+--   psql -X -v rows=100000 -v iterations=3 -v dir=/tmp -f bench/bench.sql
+--
+
+\set ON_ERROR_STOP on
+\set QUIET on
+
+\if :{?rows}
+\else
+\set rows 100000
+\endif
+\if :{?iterations}
+\else
+\set iterations 3
+\endif
+\if :{?dir}
+\else
+\set dir /tmp
+\endif
+\if :{?label}
+\else
+\set label ''
+\endif
+
+set client_min_messages = warning;
+create extension if not exists pg_custom_copy_formats;
+load 'pg_custom_copy_formats';
+
+drop schema if exists copy_bench cascade;
+create schema copy_bench;
+set search_path = copy_bench, public;
+
+--
+-- Datasets.  The values are derived from the row number only, so that every
+-- run loads the same data.
+--
+
+-- a few small columns
+create unlogged table narrow (id int8, v int4, flag bool, d date);
+insert into narrow
+  select i, (i * 7919) % 100000, i % 3 = 0, date '2020-01-01' + (i % 1000)::int
+  from generate_series(1, :rows) i;
+
+-- many columns, mostly NULL
+select format('create unlogged table wide_sparse (id int8, %s)',
+              string_agg(format('c%s int4', c), ', ' order by c))
+  from generate_series(1, 50) c \gexec
+select format('insert into wide_sparse select i, %s from generate_series(1, %s) i',
+              string_agg(format('case when i %% 10 = %s then i * %s end', c % 10, c),
+                         ', ' order by c),
+              :rows)
+  from generate_series(1, 50) c \gexec
+
+-- long strings, some of them with characters to escape
+create unlogged table text_heavy (id int8, title text, body text);
+insert into text_heavy
+  select i, 'title ' || md5(i::text),
+         repeat(md5(i::text), 8) ||
+         case when i % 10 = 0 then E' "quoted"\ttab\\backslash' else '' end
+  from generate_series(1, :rows) i;
+
+-- numbers of several types
+create unlogged table numeric_heavy (id int8, a int4, b int8, c float8,
+                                     d numeric(14, 4), e numeric, f float4);
+insert into numeric_heavy
+  select i, (i * 31) % 1000000, i * 1000003, i / 7.0,
+         (i * 12.3456)::numeric(14, 4), i::numeric / 13, (i % 1000) / 3.0
+  from generate_series(1, :rows) i;
+
+-- documents with nested objects and arrays
+create unlogged table nested_jsonb (id int8, doc jsonb);
+insert into nested_jsonb
+  select i, jsonb_build_object(
+           'user', jsonb_build_object('id', i % 1000, 'name', 'user' || (i % 1000)),
+           'tags', jsonb_build_array('t' || (i % 5), 't' || (i % 7)),
+           'metrics', jsonb_build_object('a', i % 100, 'b', (i % 1000) / 10.0),
+           'active', i % 2 = 0)
+  from generate_series(1, :rows) i;
+
+--
+-- Run COPY TO and COPY FROM with each format, and return the best times.
+--
+create function run(dataset text, source text, fmt text, compressed bool,
+                    dir text, iterations int,
+                    out direction text, out nrows int8, out bytes int8,
+                    out seconds float8)
+returns setof record
+language plpgsql as $$
+declare
+  path text := format('%s/copy_bench_%s.%s%s', dir, dataset, fmt,
+                      case when compressed then '.gz' else '' end);
+  target text;
+  to_options text;
+  from_options text;
+  dest text;
+  src text;
+  start timestamptz;
+  elapsed float8;
+  best_to float8;
+  best_from float8;
+begin
+  if fmt = 'jsonlines' then
+    -- COPY FROM detects gzip by the file name extension
+    from_options := format('format %L', fmt);
+    to_options := from_options ||
+                  case when compressed then ', compression ''gzip''' else '' end;
+    dest := quote_literal(path);
+    src := quote_literal(path);
+  else
+    -- the built-in formats are compressed by piping them through gzip
+    to_options := format('format %s', fmt);
+    from_options := to_options;
+    dest := case when compressed
+                 then format('program %L', format('gzip -c > %s', path))
+                 else quote_literal(path) end;
+    src := case when compressed
+                then format('program %L', format('gzip -dc %s', path))
+                else quote_literal(path) end;
+  end if;
+
+  target := format('%I_in', dataset);
+  execute format('create unlogged table if not exists %s (like %I)', target, source);
+
+  for i in 1 .. iterations loop
+    start := clock_timestamp();
+    execute format('copy %I to %s with (%s)', source, dest, to_options);
+    elapsed := extract(epoch from clock_timestamp() - start);
+    best_to := least(best_to, elapsed);
+
+    execute format('truncate %s', target);
+    start := clock_timestamp();
+    execute format('copy %s from %s with (%s)', target, src, from_options);
+    elapsed := extract(epoch from clock_timestamp() - start);
+    best_from := least(best_from, elapsed);
+  end loop;
+
+  execute format('select count(*) from %s', target) into nrows;
+  bytes := (pg_stat_file(path)).size;
+
+  direction := 'to';
+  seconds := best_to;
+  return next;
+  direction := 'from';
+  seconds := best_from;
+  return next;
+
+  execute format('drop table %s', target);
+end;
+$$;
+
+create temp table results (dataset text, format text, direction text,
+                           nrows int8, bytes int8, seconds float8);
+
+select format('insert into results select %L, %L, r.* from run(%L, %L, %L, %s, %L, %s) r',
+              d.name, f.fmt, d.name, d.source, f.fmt, d.compressed,
+              :'dir', :iterations)
+  from (values ('narrow', 'narrow', false),
+               ('wide_sparse', 'wide_sparse', false),
+               ('text_heavy', 'text_heavy', false),
+               ('numeric_heavy', 'numeric_heavy', false),
+               ('nested_jsonb', 'nested_jsonb', false),
+               ('gzip', 'text_heavy', true)) d(name, source, compressed),
+       (values ('jsonlines'), ('text'), ('csv'), ('binary')) f(fmt)
+  order by d.name, f.fmt \gexec
+
+\pset format csv
+select :'label' as label, dataset, format, direction, nrows as rows, bytes,
+       round(seconds::numeric, 6) as seconds,
+       round((bytes / 1048576.0 / nullif(seconds, 0))::numeric, 2) as mb_per_s,
+       round((nrows / nullif(seconds, 0))::numeric, 0) as rows_per_s
+  from results
+  order by dataset, format, direction desc;
+
+reset search_path;
+drop schema copy_bench cascade;
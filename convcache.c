@@ -0,0 +1,106 @@
+/*--------------------------------------------------------------------------
+ *
+ * convcache.c
+ *		Cache of converted values for low-cardinality columns.
+ *
+ * Columns such as status codes, country codes, enums and domains often take
+ * a few hundred distinct values over millions of rows.  Caching the Datum
+ * converted from each input text saves the input function call, including
+ * the syscache lookups of enum input and the constraint checks of domains,
+ * for every repeated value.
+ *
+ * The cache is bounded in the number of keys and in the size of the keys
+ * and the values, and turns itself off for columns where it doesn't pay,
+ * e.g. unique identifiers.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		convcache.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "utils/datum.h"
+#include "utils/lsyscache.h"
+
+#include "pg_custom_copy_formats.h"
+
+/*
+ * Create an empty cache for values of the given type.  Keys and values are
+ * copied into the current memory context.
+ */
+CopyConvCache *
+CopyConvCacheCreate(Oid typid)
+{
+	CopyConvCache *cache = palloc0(sizeof(CopyConvCache));
+
+	cache->context = CurrentMemoryContext;
+	get_typlenbyval(typid, &cache->typlen, &cache->typbyval);
+	cache->enabled = true;
+
+	return cache;
+}
+
+/*
+ * Called at the end of each lookup window.  Disable the cache for good if
+ * the hit rate was too low.
+ */
+void
+CopyConvCacheCheckHitRate(CopyConvCache *cache)
+{
+	if (cache->hits * 2 < cache->lookups)
+		cache->enabled = false;
+
+	cache->lookups = 0;
+	cache->hits = 0;
+}
+
+/*
+ * Add the converted value of the given input text.  Nothing happens if the
+ * cache is full or the key or the value is too big.
+ */
+void
+CopyConvCacheInsert(CopyConvCache *cache, const char *key, int keylen,
+					uint32 hash, Datum value)
+{
+	uint32		mask = CONV_CACHE_SIZE - 1;
+	char	   *keycopy;
+
+	if (!cache->enabled || cache->nkeys >= CONV_CACHE_MAX_KEYS ||
+		keylen > CONV_CACHE_MAX_KEYLEN)
+		return;
+
+	if (!cache->typbyval)
+	{
+		Size		size = datumGetSize(value, false, cache->typlen);
+		char	   *valcopy;
+
+		if (size > CONV_CACHE_MAX_VALUELEN)
+			return;
+
+		valcopy = MemoryContextAlloc(cache->context, size);
+		memcpy(valcopy, DatumGetPointer(value), size);
+		value = PointerGetDatum(valcopy);
+	}
+
+	keycopy = MemoryContextAlloc(cache->context, Max(keylen, 1));
+	memcpy(keycopy, key, keylen);
+
+	for (uint32 i = hash & mask;; i = (i + 1) & mask)
+	{
+		CopyConvCacheEntry *entry = &cache->entries[i];
+
+		if (entry->key == NULL)
+		{
+			entry->key = keycopy;
+			entry->keylen = keylen;
+			entry->hash = hash;
+			entry->value = value;
+			cache->nkeys++;
+			return;
+		}
+	}
+}
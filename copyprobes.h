@@ -0,0 +1,77 @@
+/*--------------------------------------------------------------------------
+ *
+ * copyprobes.h
+ *		Static tracepoints of the custom COPY formats.
+ *
+ * The probes are compiled in on Linux when PostgreSQL is built with
+ * --enable-dtrace (-Ddtrace=enabled with meson), using the USDT macros of
+ * systemtap's <sys/sdt.h>, and are no-op instructions until a tracer attaches
+ * to them.  Otherwise they compile to nothing.  All probes belong to the
+ * "pg_custom_copy_formats" provider, e.g. with bpftrace:
+ *
+ *	usdt:/path/to/pg_custom_copy_formats.so:pg_custom_copy_formats:line__read
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		copyprobes.h
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#ifndef COPYPROBES_H
+#define COPYPROBES_H
+
+#if defined(ENABLE_DTRACE) && defined(__linux__)
+
+#include <sys/sdt.h>
+
+/* A line was read into line_buf: (uint64 lineno, int length) */
+#define TRACE_COPY_LINE_READ(lineno, len) \
+	DTRACE_PROBE2(pg_custom_copy_formats, line__read, lineno, len)
+
+/* input_buf was refilled: (int bytes) */
+#define TRACE_COPY_BUFFER_REFILL(nbytes) \
+	DTRACE_PROBE1(pg_custom_copy_formats, buffer__refill, nbytes)
+
+/* A block was decompressed: (int input bytes, int output bytes) */
+#define TRACE_COPY_DECOMPRESS_BLOCK(inbytes, outbytes) \
+	DTRACE_PROBE2(pg_custom_copy_formats, decompress__block, inbytes, outbytes)
+
+/* A block was compressed: (int input bytes, int output bytes) */
+#define TRACE_COPY_COMPRESS_BLOCK(inbytes, outbytes) \
+	DTRACE_PROBE2(pg_custom_copy_formats, compress__block, inbytes, outbytes)
+
+/* Parsing of a row started and ended: (uint64 lineno[, bool skipped]) */
+#define TRACE_COPY_ROW_PARSE_START(lineno) \
+	DTRACE_PROBE1(pg_custom_copy_formats, row__parse__start, lineno)
+#define TRACE_COPY_ROW_PARSE_DONE(lineno, skipped) \
+	DTRACE_PROBE2(pg_custom_copy_formats, row__parse__done, lineno, skipped)
+
+/* A row was skipped by a soft error: (uint64 lineno, char *column or NULL) */
+#define TRACE_COPY_CONVERSION_FAILURE(lineno, colname) \
+	DTRACE_PROBE2(pg_custom_copy_formats, conversion__failure, lineno, colname)
+
+/* Output data was flushed: (int bytes) */
+#define TRACE_COPY_FLUSH(nbytes) \
+	DTRACE_PROBE1(pg_custom_copy_formats, flush, nbytes)
+
+/* Buffered rows were written to a table: (Oid relid, int rows) */
+#define TRACE_COPY_TABLE_FLUSH(relid, nrows) \
+	DTRACE_PROBE2(pg_custom_copy_formats, table__flush, relid, nrows)
+
+#else
+
+#define TRACE_COPY_LINE_READ(lineno, len) do {} while (0)
+#define TRACE_COPY_BUFFER_REFILL(nbytes) do {} while (0)
+#define TRACE_COPY_DECOMPRESS_BLOCK(inbytes, outbytes) do {} while (0)
+#define TRACE_COPY_COMPRESS_BLOCK(inbytes, outbytes) do {} while (0)
+#define TRACE_COPY_ROW_PARSE_START(lineno) do {} while (0)
+#define TRACE_COPY_ROW_PARSE_DONE(lineno, skipped) do {} while (0)
+#define TRACE_COPY_CONVERSION_FAILURE(lineno, colname) do {} while (0)
+#define TRACE_COPY_FLUSH(nbytes) do {} while (0)
+#define TRACE_COPY_TABLE_FLUSH(relid, nrows) do {} while (0)
+
+#endif
+
+#endif							/* COPYPROBES_H */
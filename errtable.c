@@ -0,0 +1,166 @@
+/*--------------------------------------------------------------------------
+ *
+ * errtable.c
+ *		Capture of the rows skipped by COPY FROM into an error table.
+ *
+ * With ON_ERROR ignore and the 'error_table' option, the rows that fail to
+ * load are recorded in the given table instead of being just counted.  The
+ * table must have the following columns, and any other columns are filled
+ * with their default values:
+ *
+ *	lineno bigint		-- line number in the input
+ *	column_name text	-- column that failed to convert, or NULL
+ *	message text		-- error message
+ *	raw_line text		-- input line
+ *
+ * The rows are inserted through sidetable.c like the route tables of
+ * jsonroute.c, so the same restrictions apply.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		errtable.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "executor/executor.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_relation.h"
+#include "rewrite/rewriteHandler.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+#include "pg_custom_copy_formats.h"
+
+struct CopyErrorTable
+{
+	CopySideTable *table;
+
+	/* attribute numbers of the required columns */
+	AttrNumber	lineno_attnum;
+	AttrNumber	column_attnum;
+	AttrNumber	message_attnum;
+	AttrNumber	line_attnum;
+
+	ExprState **defexprs;		/* indexed by attnum - 1 */
+};
+
+/*
+ * Look up the required column 'name' of type 'typid'.
+ */
+static AttrNumber
+errtable_column(Relation rel, const char *name, Oid typid)
+{
+	AttrNumber	attnum = attnameAttNum(rel, name, false);
+
+	if (attnum == InvalidAttrNumber ||
+		TupleDescAttr(RelationGetDescr(rel), attnum - 1)->atttypid != typid)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("error table \"%s\" must have column \"%s\" of type %s",
+						RelationGetRelationName(rel), name,
+						format_type_be(typid))));
+
+	return attnum;
+}
+
+/*
+ * Open the error table and prepare the default values of its other columns.
+ */
+CopyErrorTable *
+CopyErrorTableOpen(const char *tablename)
+{
+	CopyErrorTable *errtab = palloc0(sizeof(CopyErrorTable));
+	Relation	rel;
+	TupleDesc	tupdesc;
+
+	errtab->table = CopySideTableOpen(tablename, "error table");
+	rel = errtab->table->rel;
+	tupdesc = RelationGetDescr(rel);
+
+	errtab->lineno_attnum = errtable_column(rel, "lineno", INT8OID);
+	errtab->column_attnum = errtable_column(rel, "column_name", TEXTOID);
+	errtab->message_attnum = errtable_column(rel, "message", TEXTOID);
+	errtab->line_attnum = errtable_column(rel, "raw_line", TEXTOID);
+
+	/* The other columns get their default values */
+	errtab->defexprs = palloc0(sizeof(ExprState *) * tupdesc->natts);
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		Expr	   *defexpr;
+
+		if (att->attisdropped || att->attgenerated)
+			continue;
+
+		defexpr = (Expr *) build_column_default(rel, i + 1);
+		if (defexpr != NULL)
+		{
+			defexpr = expression_planner(defexpr);
+			errtab->defexprs[i] = ExecInitExpr(defexpr, NULL);
+		}
+	}
+
+	return errtab;
+}
+
+/*
+ * Record a skipped row.  'colname' may be NULL if the error is not specific
+ * to a column.
+ */
+void
+CopyErrorTableAdd(CopyErrorTable *errtab, uint64 lineno, const char *colname,
+				  const char *message, const char *line)
+{
+	CopySideTable *table = errtab->table;
+	TupleDesc	tupdesc = RelationGetDescr(table->rel);
+	ExprContext *econtext = GetPerTupleExprContext(table->estate);
+	TupleTableSlot *slot = CopySideTableNextSlot(table);
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(table->context);
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		if (errtab->defexprs[i] != NULL)
+			slot->tts_values[i] = ExecEvalExpr(errtab->defexprs[i], econtext,
+											   &slot->tts_isnull[i]);
+		else
+			slot->tts_isnull[i] = true;
+	}
+
+	slot->tts_values[errtab->lineno_attnum - 1] = Int64GetDatum((int64) lineno);
+	slot->tts_isnull[errtab->lineno_attnum - 1] = false;
+
+	if (colname != NULL)
+	{
+		slot->tts_values[errtab->column_attnum - 1] = CStringGetTextDatum(colname);
+		slot->tts_isnull[errtab->column_attnum - 1] = false;
+	}
+	else
+		slot->tts_isnull[errtab->column_attnum - 1] = true;
+
+	slot->tts_values[errtab->message_attnum - 1] = CStringGetTextDatum(message);
+	slot->tts_isnull[errtab->message_attnum - 1] = false;
+
+	slot->tts_values[errtab->line_attnum - 1] = CStringGetTextDatum(line);
+	slot->tts_isnull[errtab->line_attnum - 1] = false;
+
+	MemoryContextSwitchTo(oldcxt);
+
+	CopySideTableInsert(table, slot);
+}
+
+/*
+ * Write out the buffered rows and close the error table.
+ */
+void
+CopyErrorTableClose(CopyErrorTable *errtab)
+{
+	(void) CopySideTableClose(errtab->table);
+}
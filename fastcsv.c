@@ -0,0 +1,546 @@
+/*--------------------------------------------------------------------------
+ *
+ * fastcsv.c
+ *		CSV format support for COPY FROM command using a structural index.
+ *
+ * Instead of examining the input byte by byte, each input buffer is first
+ * indexed in blocks of 64 bytes: bitmasks of the quote, delimiter and
+ * newline characters of a block are built with vector comparisons, and the
+ * bytes inside quoted fields are found by the prefix XOR of the quote mask
+ * (each quote toggles the "inside" state of all the bytes after it; a
+ * doubled quote toggles it twice).  The delimiters and newlines outside
+ * quotes are then the field and record boundaries, whose positions are
+ * recorded in the index.  Rows are cut out of the buffer by walking the
+ * index, so the bytes of a field are only rewritten when it has quotes.
+ *
+ * The quoting rules are those of RFC 4180 as with the built-in CSV format:
+ * a quote inside a quoted section is escaped by doubling it, a quoted
+ * section may start anywhere in a field, an unquoted empty field is NULL
+ * (unless the 'null' option says otherwise) and a quoted empty field is an
+ * empty string.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		fastcsv.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "commands/copyapi.h"
+#include "commands/copystate.h"
+#include "commands/defrem.h"
+#include "port/pg_bitutils.h"
+#include "port/simd.h"
+#include "utils/lsyscache.h"
+
+#include "pg_custom_copy_formats.h"
+
+#define FASTCSV_BLOCK_SIZE 64
+
+/*
+ * Struct for COPY options for fastcsv format.
+ */
+typedef struct FastCsvOptions
+{
+	char		delimiter;
+	char		quote;
+	bool		header;
+	char	   *null_print;		/* NULL means an unquoted empty field */
+} FastCsvOptions;
+
+typedef struct CopyFromStateFastCsv
+{
+	CopyFromStateData base;
+
+	FastCsvOptions options;
+
+	bool		header_skipped;
+
+	/* Positions of the structural characters in input_buf */
+	uint32	   *index;
+	int			index_len;
+	int			index_pos;		/* next entry to process */
+
+	/* all ones if the end of the last indexed block was inside quotes */
+	uint64		quote_carry;
+
+	/*
+	 * End offsets of the fields of the current record in line_buf.  Each
+	 * field is NUL-terminated in place of its delimiter.
+	 */
+	int		   *field_ends;
+	int			nfields;
+	int			max_fields;
+
+	/* Input pipeline shared with the other text-based formats */
+	CopyInputBuffer input;
+} CopyFromStateFastCsv;
+
+/*
+ * Compute the bitmasks of the bytes of a 64-byte block equal to the quote,
+ * the delimiter and newline characters.  Bit i corresponds to p[i].
+ */
+static inline void
+fastcsv_block_masks(const char *p, char quote, char delim, uint64 *quote_mask,
+					uint64 *delim_mask, uint64 *newline_mask)
+{
+#ifndef USE_NO_SIMD
+	const Vector8 quotes = vector8_broadcast(quote);
+	const Vector8 delims = vector8_broadcast(delim);
+	const Vector8 newlines = vector8_broadcast('\n');
+	uint64		q = 0;
+	uint64		d = 0;
+	uint64		n = 0;
+
+	for (int i = 0; i < FASTCSV_BLOCK_SIZE; i += sizeof(Vector8))
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) p + i);
+		q |= (uint64) vector8_highbit_mask(vector8_eq(chunk, quotes)) << i;
+		d |= (uint64) vector8_highbit_mask(vector8_eq(chunk, delims)) << i;
+		n |= (uint64) vector8_highbit_mask(vector8_eq(chunk, newlines)) << i;
+	}
+
+	*quote_mask = q;
+	*delim_mask = d;
+	*newline_mask = n;
+#else
+	uint64		q = 0;
+	uint64		d = 0;
+	uint64		n = 0;
+
+	for (int i = 0; i < FASTCSV_BLOCK_SIZE; i++)
+	{
+		q |= (uint64) (p[i] == quote) << i;
+		d |= (uint64) (p[i] == delim) << i;
+		n |= (uint64) (p[i] == '\n') << i;
+	}
+
+	*quote_mask = q;
+	*delim_mask = d;
+	*newline_mask = n;
+#endif
+}
+
+/*
+ * Bit i of the result is the XOR of bits 0..i of x.  Applied to a quote mask,
+ * this gives the bytes from an opening quote up to, but not including, the
+ * closing quote.
+ */
+static inline uint64
+fastcsv_prefix_xor(uint64 x)
+{
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+
+	return x;
+}
+
+/*
+ * Build the structural index of the data just loaded into input_buf.
+ */
+static void
+fastcsv_index_buffer(CopyFromStateFastCsv *cstate)
+{
+	CopyInputBuffer *buf = &cstate->input;
+	int			len = buf->input_buf_len;
+	int			n = 0;
+
+	for (int pos = 0; pos < len; pos += FASTCSV_BLOCK_SIZE)
+	{
+		const char *p = buf->input_buf + pos;
+		char		tail[FASTCSV_BLOCK_SIZE];
+		uint64		quote_mask;
+		uint64		delim_mask;
+		uint64		newline_mask;
+		uint64		inside;
+		uint64		structural;
+
+		/* Pad the last partial block with NULs, which are not structural */
+		if (len - pos < FASTCSV_BLOCK_SIZE)
+		{
+			memset(tail, 0, FASTCSV_BLOCK_SIZE);
+			memcpy(tail, p, len - pos);
+			p = tail;
+		}
+
+		fastcsv_block_masks(p, cstate->options.quote, cstate->options.delimiter,
+							&quote_mask, &delim_mask, &newline_mask);
+
+		inside = fastcsv_prefix_xor(quote_mask) ^ cstate->quote_carry;
+		cstate->quote_carry = (uint64) ((int64) inside >> 63);
+
+		structural = (delim_mask | newline_mask) & ~inside;
+		while (structural != 0)
+		{
+			cstate->index[n++] = pos + pg_rightmost_one_pos64(structural);
+			structural &= structural - 1;
+		}
+	}
+
+	cstate->index_len = n;
+	cstate->index_pos = 0;
+}
+
+/*
+ * Append the end of the current field to field_ends.
+ */
+static inline void
+fastcsv_end_field(CopyFromStateFastCsv *cstate)
+{
+	if (cstate->nfields >= cstate->max_fields)
+	{
+		cstate->max_fields *= 2;
+		cstate->field_ends = repalloc(cstate->field_ends,
+									  sizeof(int) * cstate->max_fields);
+	}
+
+	cstate->field_ends[cstate->nfields++] = cstate->input.line_buf.len;
+}
+
+/*
+ * Read the next record into line_buf, splitting it into fields using the
+ * structural index.  Returns true if we reached EOF without reading any data.
+ */
+static bool
+fastcsv_read_record(CopyFromStateFastCsv *cstate)
+{
+	CopyInputBuffer *buf = &cstate->input;
+	StringInfo	line_buf = &buf->line_buf;
+
+	resetStringInfo(line_buf);
+	cstate->nfields = 0;
+
+	for (;;)
+	{
+		int			start;
+
+		/* Load and index more data if needed */
+		if (INPUT_BUF_BYTES(buf) <= 0)
+		{
+			if (!CopyInputBufferLoad((CopyFromState) cstate, buf))
+			{
+				if (cstate->quote_carry != 0)
+					ereport(ERROR,
+							(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+							 errmsg("unterminated CSV quoted field")));
+
+				if (line_buf->len == 0 && cstate->nfields == 0)
+					return true;
+				break;
+			}
+
+			fastcsv_index_buffer(cstate);
+		}
+
+		start = buf->input_buf_index;
+
+		while (cstate->index_pos < cstate->index_len)
+		{
+			int			pos = cstate->index[cstate->index_pos++];
+
+			appendBinaryStringInfo(line_buf, buf->input_buf + start,
+								   pos - start);
+			buf->input_buf_index = pos + 1;
+
+			if (buf->input_buf[pos] == '\n')
+				goto done;
+
+			/* A delimiter; terminate the field in its place */
+			fastcsv_end_field(cstate);
+			appendStringInfoCharMacro(line_buf, '\0');
+			start = pos + 1;
+		}
+
+		/* The record continues in the next input buffer */
+		appendBinaryStringInfo(line_buf, buf->input_buf + start,
+							   buf->input_buf_len - start);
+		buf->input_buf_index = buf->input_buf_len;
+	}
+
+done:
+	/* Accept CRLF line endings as well */
+	if (line_buf->len > 0 && line_buf->data[line_buf->len - 1] == '\r')
+		line_buf->data[--line_buf->len] = '\0';
+
+	fastcsv_end_field(cstate);
+	cstate->base.cur_lineno++;
+
+	return false;
+}
+
+/*
+ * Remove the quotes of the quoted sections of a field in place.  Returns
+ * false if the field has no quotes.  Like with the built-in CSV format, a
+ * quoted section may start anywhere in the field, so ab"c,d" is abc,d, and
+ * text after the closing quote is kept.
+ */
+static bool
+fastcsv_dequote(char *field, int len, char quote)
+{
+	char	   *r = memchr(field, quote, len);
+	char	   *end = field + len;
+	char	   *w = r;
+	bool		in_quote = false;
+
+	if (r == NULL)
+		return false;
+
+	while (r < end)
+	{
+		if (*r == quote)
+		{
+			if (in_quote && r + 1 < end && r[1] == quote)
+			{
+				*w++ = quote;
+				r += 2;
+				continue;
+			}
+
+			in_quote = !in_quote;
+			r++;
+			continue;
+		}
+
+		*w++ = *r++;
+	}
+
+	*w = '\0';
+
+	return true;
+}
+
+static void
+FastCsvCopyFromInFunc(CopyFromState cstate, Oid atttypid, FmgrInfo *finfo,
+					  Oid *typioparam)
+{
+	Oid			func_oid;
+
+	getTypeInputInfo(atttypid, &func_oid, typioparam);
+	fmgr_info(func_oid, finfo);
+}
+
+static void
+FastCsvCopyFromStart(CopyFromState ccstate, TupleDesc tupDesc)
+{
+	CopyFromStateFastCsv *cstate = (CopyFromStateFastCsv *) ccstate;
+
+	if (cstate->options.delimiter == '\0')
+		cstate->options.delimiter = ',';
+	if (cstate->options.quote == '\0')
+		cstate->options.quote = '"';
+
+	if (cstate->options.delimiter == cstate->options.quote)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("COPY delimiter and quote must be different")));
+
+	cstate->index = palloc(sizeof(uint32) * INPUT_BUF_SIZE);
+	cstate->index_len = cstate->index_pos = 0;
+	cstate->quote_carry = 0;
+
+	cstate->max_fields = Max(list_length(cstate->base.attnumlist), 8);
+	cstate->field_ends = palloc(sizeof(int) * cstate->max_fields);
+
+	CopyInputBufferInit((CopyFromState) cstate, &cstate->input,
+						CopyInputDetectCompression(cstate->base.filename));
+
+	if (CopyStatsSharedEnabled())
+		cstate->input.stats = CopyStatsCreate();
+}
+
+static bool
+FastCsvCopyFromOneRow(CopyFromState ccstate, ExprContext *econtext, Datum *values,
+					  bool *nulls, CopyFromRowInfo *rowinfo)
+{
+	CopyFromStateFastCsv *cstate = (CopyFromStateFastCsv *) ccstate;
+	TupleDesc	tupdesc = RelationGetDescr(cstate->base.rel);
+	char	   *data;
+	int			fieldno = 0;
+	int			start = 0;
+	ListCell   *lc;
+	CopyStats  *stats = cstate->input.stats;
+
+	CopyStatsBeginRow(stats);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_SPLIT);
+
+	/* Skip the header line */
+	if (cstate->options.header && !cstate->header_skipped)
+	{
+		cstate->header_skipped = true;
+		if (fastcsv_read_record(cstate))
+			return false;
+	}
+
+	if (fastcsv_read_record(cstate))
+		return false;
+
+	data = cstate->input.line_buf.data;
+
+	CopyStatsAddBytes(stats, COPY_PHASE_SPLIT, cstate->input.line_buf.len);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_CONVERT);
+
+	if (cstate->nfields > list_length(cstate->base.attnumlist))
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("extra data after last expected column")));
+
+	foreach(lc, cstate->base.attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		int			m = attnum - 1;
+		Form_pg_attribute att = TupleDescAttr(tupdesc, m);
+		char	   *field;
+		int			len;
+		bool		quoted;
+
+		if (fieldno >= cstate->nfields)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("missing data for column \"%s\"",
+							NameStr(att->attname))));
+
+		field = data + start;
+		len = cstate->field_ends[fieldno] - start;
+		start = cstate->field_ends[fieldno] + 1;
+		fieldno++;
+
+		quoted = fastcsv_dequote(field, len, cstate->options.quote);
+
+		if (!quoted &&
+			(cstate->options.null_print != NULL ?
+			 strcmp(field, cstate->options.null_print) == 0 : len == 0))
+		{
+			nulls[m] = true;
+			continue;
+		}
+
+		if (!InputFunctionCallSafe(&cstate->base.in_functions[m],
+								   field,
+								   cstate->base.typioparams[m],
+								   att->atttypmod,
+								   (Node *) cstate->base.escontext,
+								   &values[m]))
+		{
+			/* COPY sees the error in escontext and skips the row */
+			CopyInputSkipRow((CopyFromState) cstate, NameStr(att->attname));
+			break;
+		}
+
+		nulls[m] = false;
+	}
+
+	/* Set output parameters */
+	if (rowinfo)
+	{
+		rowinfo->lineno = cstate->base.cur_lineno;
+		rowinfo->tuplen = cstate->input.line_buf.len;
+	}
+
+	if (stats != NULL)
+	{
+		/* skipped rows are counted as errors at the end */
+		if (cstate->base.escontext == NULL ||
+			!cstate->base.escontext->error_occurred)
+			stats->rows++;
+		(void) CopyStatsSwitch(stats, COPY_PHASE_OTHER);
+	}
+
+	return true;
+}
+
+static void
+FastCsvCopyFromEnd(CopyFromState ccstate)
+{
+	CopyFromStateFastCsv *cstate = (CopyFromStateFastCsv *) ccstate;
+	CopyStats  *stats = cstate->input.stats;
+
+	if (stats != NULL)
+		CopyStatsEndRows(stats);
+
+	CopyInputBufferEnd(&cstate->input);
+
+	if (stats != NULL)
+	{
+		stats->errors = cstate->base.num_errors;
+		CopyStatsFinish(stats, "fastcsv", true, false);
+	}
+}
+
+static Size
+FastCsvCopyFromEstimateSpace(void)
+{
+	return sizeof(CopyFromStateFastCsv);
+}
+
+static char
+fastcsv_get_char_option(DefElem *option)
+{
+	char	   *optval = defGetString(option);
+
+	if (strlen(optval) != 1 || optval[0] == '\n' || optval[0] == '\r')
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("COPY %s must be a single one-byte character other than newline",
+						option->defname)));
+
+	return optval[0];
+}
+
+static bool
+FastCsvCopyFromProcessOneOption(CopyFromState ccstate, DefElem *option)
+{
+	CopyFromStateFastCsv *cstate = (CopyFromStateFastCsv *) ccstate;
+
+	if (strcmp(option->defname, "delimiter") == 0)
+	{
+		cstate->options.delimiter = fastcsv_get_char_option(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "quote") == 0)
+	{
+		cstate->options.quote = fastcsv_get_char_option(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "header") == 0)
+	{
+		cstate->options.header = defGetBoolean(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "null") == 0)
+	{
+		cstate->options.null_print = defGetString(option);
+
+		return true;
+	}
+
+	return false;
+}
+
+static const CopyFromRoutine FastCsvCopyFromRoutine = {
+	.CopyFromEstimateStateSpace = FastCsvCopyFromEstimateSpace,
+	.CopyFromProcessOneOption = FastCsvCopyFromProcessOneOption,
+	.CopyFromInFunc = FastCsvCopyFromInFunc,
+	.CopyFromStart = FastCsvCopyFromStart,
+	.CopyFromOneRow = FastCsvCopyFromOneRow,
+	.CopyFromEnd = FastCsvCopyFromEnd,
+};
+
+void
+RegisterFastCsvCopyFormat(void)
+{
+	RegisterCopyCustomFormat("fastcsv",
+							 &FastCsvCopyFromRoutine,
+							 NULL);
+}
@@ -0,0 +1,647 @@
+/*--------------------------------------------------------------------------
+ *
+ * fixedwidth.c
+ *		Fixed-width record format support for COPY command.
+ *
+ * Each column occupies a fixed byte range of the record, given by the
+ * 'layout' option as 'column=offset:length, ...' with zero-based offsets.
+ * Records are either terminated by a newline, or have a fixed length given
+ * by the 'record_length' option.  Fields are padded with the 'padding'
+ * character (a space by default), and a field that consists only of padding
+ * represents NULL.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		fixedwidth.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "commands/copyapi.h"
+#include "commands/copystate.h"
+#include "commands/defrem.h"
+#include "parser/scansup.h"
+#include "port/simd.h"
+#include "utils/lsyscache.h"
+
+#include "pg_custom_copy_formats.h"
+
+/*
+ * A field of the record layout.
+ */
+typedef struct FixedWidthField
+{
+	char	   *attname;
+	int			attnum;			/* resolved at the start of COPY */
+	int			offset;
+	int			length;
+} FixedWidthField;
+
+/*
+ * Struct for COPY options for fixedwidth format.
+ */
+typedef struct FixedWidthOptions
+{
+	List	   *layout;			/* list of FixedWidthField */
+	int			record_length;	/* 0 if records are newline-terminated */
+	char		padding;
+} FixedWidthOptions;
+
+typedef struct CopyToStateFixedWidth
+{
+	CopyToStateData base;
+
+	FixedWidthOptions options;
+
+	FixedWidthField *fields;	/* in the order of attnumlist */
+	int			nfields;
+	int			record_len;
+	char	   *record;			/* record being built */
+
+	CopyStats  *stats;			/* NULL unless collecting statistics */
+} CopyToStateFixedWidth;
+
+typedef struct CopyFromStateFixedWidth
+{
+	CopyFromStateData base;
+
+	FixedWidthOptions options;
+
+	FixedWidthField *fields;	/* in the order of attnumlist */
+	int			nfields;
+
+	/* Input pipeline shared with the other text-based formats */
+	CopyInputBuffer input;
+} CopyFromStateFixedWidth;
+
+/*
+ * Parse the 'layout' option value.
+ */
+static List *
+fixedwidth_parse_layout(const char *str)
+{
+	List	   *layout = NIL;
+	char	   *rawstring = pstrdup(str);
+	char	   *tok;
+	char	   *saveptr;
+
+	for (tok = strtok_r(rawstring, ",", &saveptr);
+		 tok != NULL;
+		 tok = strtok_r(NULL, ",", &saveptr))
+	{
+		FixedWidthField *field;
+		char	   *eq;
+		char	   *name;
+		char	   *endptr;
+		long		offset;
+		long		length;
+
+		eq = strchr(tok, '=');
+		if (eq == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid layout entry \"%s\"", tok),
+					 errhint("Layout entries must be of the form \"column=offset:length\".")));
+		*eq = '\0';
+
+		/* trim the column name */
+		name = tok;
+		while (scanner_isspace(*name))
+			name++;
+		endptr = eq;
+		while (endptr > name && scanner_isspace(endptr[-1]))
+			endptr--;
+		*endptr = '\0';
+
+		errno = 0;
+		offset = strtol(eq + 1, &endptr, 10);
+		if (errno != 0 || endptr == eq + 1 || *endptr != ':' ||
+			offset < 0 || offset > MaxAllocSize)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid offset in layout entry for column \"%s\"", name)));
+
+		errno = 0;
+		length = strtol(endptr + 1, &endptr, 10);
+		while (scanner_isspace(*endptr))
+			endptr++;
+		if (errno != 0 || *endptr != '\0' || length <= 0 || length > MaxAllocSize)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid length in layout entry for column \"%s\"", name)));
+
+		if (name[0] == '\0')
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("layout entry without column name")));
+
+		field = palloc0(sizeof(FixedWidthField));
+		field->attname = name;
+		field->offset = (int) offset;
+		field->length = (int) length;
+		layout = lappend(layout, field);
+	}
+
+	return layout;
+}
+
+static bool
+fixedwidth_process_option(FixedWidthOptions *opts, DefElem *option)
+{
+	if (strcmp(option->defname, "layout") == 0)
+	{
+		opts->layout = fixedwidth_parse_layout(defGetString(option));
+
+		return true;
+	}
+	else if (strcmp(option->defname, "record_length") == 0)
+	{
+		opts->record_length = defGetInt32(option);
+		if (opts->record_length <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("record_length must be greater than zero")));
+
+		return true;
+	}
+	else if (strcmp(option->defname, "padding") == 0)
+	{
+		char	   *optval = defGetString(option);
+
+		if (strlen(optval) != 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("padding must be a single one-byte character")));
+		opts->padding = optval[0];
+
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Map the layout onto the columns to copy.  Returns an array of fields in the
+ * order of attnumlist.
+ */
+static FixedWidthField *
+fixedwidth_resolve_layout(FixedWidthOptions *opts, List *attnumlist,
+						  TupleDesc tupDesc)
+{
+	FixedWidthField *fields;
+	ListCell   *lc;
+	int			i = 0;
+
+	if (opts->layout == NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("fixedwidth format requires the layout option")));
+
+	if (opts->padding == '\0')
+		opts->padding = ' ';
+
+	fields = palloc0(sizeof(FixedWidthField) * Max(list_length(attnumlist), 1));
+
+	foreach(lc, attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		char	   *attname = NameStr(TupleDescAttr(tupDesc, attnum - 1)->attname);
+		ListCell   *lc2;
+		bool		found = false;
+
+		foreach(lc2, opts->layout)
+		{
+			FixedWidthField *field = (FixedWidthField *) lfirst(lc2);
+
+			if (strcmp(field->attname, attname) == 0)
+			{
+				fields[i] = *field;
+				fields[i].attnum = field->attnum = attnum;
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("column \"%s\" is missing in the layout", attname)));
+		i++;
+	}
+
+	foreach(lc, opts->layout)
+	{
+		FixedWidthField *field = (FixedWidthField *) lfirst(lc);
+
+		if (field->attnum == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" in the layout is not copied", field->attname)));
+	}
+
+	return fields;
+}
+
+/*
+ * Return the length of the string without the trailing padding.
+ */
+static inline int
+fixedwidth_trim_right(const char *s, int len, char pad)
+{
+#ifndef USE_NO_SIMD
+	const Vector8 padv = vector8_broadcast((uint8) pad);
+
+	/* Skip whole chunks of padding */
+	while (len >= (int) sizeof(Vector8))
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) s + len - sizeof(Vector8));
+		if (vector8_has_zero(vector8_eq(chunk, padv)))
+			break;
+		len -= sizeof(Vector8);
+	}
+#endif
+
+	while (len > 0 && s[len - 1] == pad)
+		len--;
+
+	return len;
+}
+
+/*
+ * Return the number of leading padding bytes of the string.
+ */
+static inline int
+fixedwidth_trim_left(const char *s, int len, char pad)
+{
+	int			i = 0;
+
+#ifndef USE_NO_SIMD
+	const Vector8 padv = vector8_broadcast((uint8) pad);
+
+	/* Skip whole chunks of padding */
+	while (i + (int) sizeof(Vector8) <= len)
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) s + i);
+		if (vector8_has_zero(vector8_eq(chunk, padv)))
+			break;
+		i += sizeof(Vector8);
+	}
+#endif
+
+	while (i < len && s[i] == pad)
+		i++;
+
+	return i;
+}
+
+/*
+ * COPY TO routines
+ */
+
+static void
+FixedWidthCopyToOutFunc(CopyToState cstate, Oid atttypid, FmgrInfo *finfo)
+{
+	Oid			func_oid;
+	bool		is_varlena;
+
+	getTypeOutputInfo(atttypid, &func_oid, &is_varlena);
+	fmgr_info(func_oid, finfo);
+}
+
+static void
+FixedWidthCopyToStart(CopyToState ccstate, TupleDesc tupDesc)
+{
+	CopyToStateFixedWidth *cstate = (CopyToStateFixedWidth *) ccstate;
+	int			max_end = 0;
+
+	cstate->fields = fixedwidth_resolve_layout(&cstate->options,
+											   cstate->base.attnumlist,
+											   tupDesc);
+	cstate->nfields = list_length(cstate->base.attnumlist);
+
+	for (int i = 0; i < cstate->nfields; i++)
+	{
+		FixedWidthField *field = &cstate->fields[i];
+
+		/* Fields must not overlap when writing the records */
+		for (int j = 0; j < i; j++)
+		{
+			FixedWidthField *other = &cstate->fields[j];
+
+			if (field->offset < other->offset + other->length &&
+				other->offset < field->offset + field->length)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("layout of columns \"%s\" and \"%s\" overlap",
+								other->attname, field->attname)));
+		}
+
+		max_end = Max(max_end, field->offset + field->length);
+	}
+
+	if (cstate->options.record_length > 0)
+	{
+		if (cstate->options.record_length < max_end)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("record_length %d is shorter than the layout",
+							cstate->options.record_length)));
+		cstate->record_len = cstate->options.record_length;
+	}
+	else
+		cstate->record_len = max_end;
+
+	cstate->record = palloc(cstate->record_len);
+
+	if (CopyStatsSharedEnabled())
+		cstate->stats = CopyStatsCreate();
+}
+
+static void
+FixedWidthCopyToOneRow(CopyToState ccstate, TupleTableSlot *slot)
+{
+	CopyToStateFixedWidth *cstate = (CopyToStateFixedWidth *) ccstate;
+
+	CopyStatsBeginRow(cstate->stats);
+	(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_ENCODE);
+
+	slot_getallattrs(slot);
+
+	memset(cstate->record, cstate->options.padding, cstate->record_len);
+
+	for (int i = 0; i < cstate->nfields; i++)
+	{
+		FixedWidthField *field = &cstate->fields[i];
+		char	   *str;
+		int			len;
+
+		/* NULL is represented by a field of padding */
+		if (slot->tts_isnull[field->attnum - 1])
+			continue;
+
+		str = OutputFunctionCall(&cstate->base.out_functions[field->attnum - 1],
+								 slot->tts_values[field->attnum - 1]);
+		len = strlen(str);
+
+		if (len > field->length)
+			ereport(ERROR,
+					(errcode(ERRCODE_STRING_DATA_RIGHT_TRUNCATION),
+					 errmsg("value too long for fixed-width column \"%s\"",
+							field->attname),
+					 errdetail("Value has %d bytes, but the field has %d bytes.",
+							   len, field->length)));
+
+		memcpy(cstate->record + field->offset, str, len);
+	}
+
+	appendBinaryStringInfo(cstate->base.fe_msgbuf, cstate->record, cstate->record_len);
+	if (cstate->options.record_length == 0)
+		appendStringInfoCharMacro(cstate->base.fe_msgbuf, '\n');
+
+	/* End of row */
+	(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_WRITE);
+	CopyStatsAddBytes(cstate->stats, COPY_PHASE_WRITE,
+					  cstate->base.fe_msgbuf->len);
+	CopyToFlushData((CopyToState) cstate);
+
+	if (cstate->stats != NULL)
+	{
+		cstate->stats->rows++;
+		(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_OTHER);
+	}
+}
+
+static void
+FixedWidthCopyToEnd(CopyToState ccstate)
+{
+	CopyToStateFixedWidth *cstate = (CopyToStateFixedWidth *) ccstate;
+
+	if (cstate->stats != NULL)
+	{
+		CopyStatsEndRows(cstate->stats);
+		CopyStatsFinish(cstate->stats, "fixedwidth", false, false);
+	}
+}
+
+/*
+ * COPY FROM routines
+ */
+
+static void
+FixedWidthCopyFromInFunc(CopyFromState cstate, Oid atttypid, FmgrInfo *finfo,
+						 Oid *typioparam)
+{
+	Oid			func_oid;
+
+	getTypeInputInfo(atttypid, &func_oid, typioparam);
+	fmgr_info(func_oid, finfo);
+}
+
+static void
+FixedWidthCopyFromStart(CopyFromState ccstate, TupleDesc tupDesc)
+{
+	CopyFromStateFixedWidth *cstate = (CopyFromStateFixedWidth *) ccstate;
+
+	cstate->fields = fixedwidth_resolve_layout(&cstate->options,
+											   cstate->base.attnumlist,
+											   tupDesc);
+	cstate->nfields = list_length(cstate->base.attnumlist);
+
+	CopyInputBufferInit((CopyFromState) cstate, &cstate->input,
+						CopyInputDetectCompression(cstate->base.filename));
+
+	if (CopyStatsSharedEnabled())
+		cstate->input.stats = CopyStatsCreate();
+}
+
+static bool
+FixedWidthCopyFromOneRow(CopyFromState ccstate, ExprContext *econtext, Datum *values,
+						 bool *nulls, CopyFromRowInfo *rowinfo)
+{
+	CopyFromStateFixedWidth *cstate = (CopyFromStateFixedWidth *) ccstate;
+	TupleDesc	tupdesc = RelationGetDescr(cstate->base.rel);
+	StringInfo	line_buf = &cstate->input.line_buf;
+	char		pad = cstate->options.padding;
+	CopyStats  *stats = cstate->input.stats;
+
+	CopyStatsBeginRow(stats);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_SPLIT);
+
+	if (cstate->options.record_length > 0)
+	{
+		if (CopyInputBufferReadBytes((CopyFromState) cstate, &cstate->input,
+									 cstate->options.record_length))
+			return false;
+
+		if (line_buf->len < cstate->options.record_length)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("unexpected EOF in the middle of a fixed-length record")));
+	}
+	else
+	{
+		if (CopyInputBufferReadLine((CopyFromState) cstate, &cstate->input))
+			return false;
+
+		/* Accept CRLF line endings as well */
+		if (line_buf->len > 0 && line_buf->data[line_buf->len - 1] == '\r')
+			line_buf->data[--line_buf->len] = '\0';
+	}
+
+	CopyStatsAddBytes(stats, COPY_PHASE_SPLIT, line_buf->len);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_CONVERT);
+
+	for (int i = 0; i < cstate->nfields; i++)
+	{
+		FixedWidthField *field = &cstate->fields[i];
+		int			m = field->attnum - 1;
+		char	   *start;
+		int			len;
+		int			skip;
+		char		saved;
+		bool		ret;
+
+		/* Short records lack the trailing fields */
+		if (field->offset >= line_buf->len)
+		{
+			nulls[m] = true;
+			continue;
+		}
+
+		start = line_buf->data + field->offset;
+		len = Min(field->length, line_buf->len - field->offset);
+
+		len = fixedwidth_trim_right(start, len, pad);
+		skip = fixedwidth_trim_left(start, len, pad);
+		start += skip;
+		len -= skip;
+
+		if (len == 0)
+		{
+			nulls[m] = true;
+			continue;
+		}
+
+		nulls[m] = false;
+
+		/*
+		 * Terminate the field in place.  The byte is restored afterwards
+		 * since it may belong to another field.
+		 */
+		saved = start[len];
+		start[len] = '\0';
+
+		ret = InputFunctionCallSafe(&cstate->base.in_functions[m],
+									start,
+									cstate->base.typioparams[m],
+									TupleDescAttr(tupdesc, m)->atttypmod,
+									(Node *) cstate->base.escontext,
+									&values[m]);
+
+		start[len] = saved;
+
+		/* On a soft error, COPY sees the error in escontext */
+		if (!ret)
+		{
+			CopyInputSkipRow((CopyFromState) cstate, field->attname);
+			break;
+		}
+	}
+
+	/* Set output parameters */
+	if (rowinfo)
+	{
+		rowinfo->lineno = cstate->base.cur_lineno;
+		rowinfo->tuplen = line_buf->len;
+	}
+
+	if (stats != NULL)
+	{
+		/* skipped rows are counted as errors at the end */
+		if (cstate->base.escontext == NULL ||
+			!cstate->base.escontext->error_occurred)
+			stats->rows++;
+		(void) CopyStatsSwitch(stats, COPY_PHASE_OTHER);
+	}
+
+	return true;
+}
+
+static void
+FixedWidthCopyFromEnd(CopyFromState ccstate)
+{
+	CopyFromStateFixedWidth *cstate = (CopyFromStateFixedWidth *) ccstate;
+	CopyStats  *stats = cstate->input.stats;
+
+	if (stats != NULL)
+		CopyStatsEndRows(stats);
+
+	CopyInputBufferEnd(&cstate->input);
+
+	if (stats != NULL)
+	{
+		stats->errors = cstate->base.num_errors;
+		CopyStatsFinish(stats, "fixedwidth", true, false);
+	}
+}
+
+static Size
+FixedWidthCopyToEstimateSpace(void)
+{
+	return sizeof(CopyToStateFixedWidth);
+}
+
+static Size
+FixedWidthCopyFromEstimateSpace(void)
+{
+	return sizeof(CopyFromStateFixedWidth);
+}
+
+static bool
+FixedWidthCopyToProcessOneOption(CopyToState ccstate, DefElem *option)
+{
+	CopyToStateFixedWidth *cstate = (CopyToStateFixedWidth *) ccstate;
+
+	return fixedwidth_process_option(&cstate->options, option);
+}
+
+static bool
+FixedWidthCopyFromProcessOneOption(CopyFromState ccstate, DefElem *option)
+{
+	CopyFromStateFixedWidth *cstate = (CopyFromStateFixedWidth *) ccstate;
+
+	return fixedwidth_process_option(&cstate->options, option);
+}
+
+static const CopyToRoutine FixedWidthCopyToRoutine = {
+	.CopyToEstimateStateSpace = FixedWidthCopyToEstimateSpace,
+	.CopyToProcessOneOption = FixedWidthCopyToProcessOneOption,
+	.CopyToOutFunc = FixedWidthCopyToOutFunc,
+	.CopyToStart = FixedWidthCopyToStart,
+	.CopyToOneRow = FixedWidthCopyToOneRow,
+	.CopyToEnd = FixedWidthCopyToEnd,
+};
+
+static const CopyFromRoutine FixedWidthCopyFromRoutine = {
+	.CopyFromEstimateStateSpace = FixedWidthCopyFromEstimateSpace,
+	.CopyFromProcessOneOption = FixedWidthCopyFromProcessOneOption,
+	.CopyFromInFunc = FixedWidthCopyFromInFunc,
+	.CopyFromStart = FixedWidthCopyFromStart,
+	.CopyFromOneRow = FixedWidthCopyFromOneRow,
+	.CopyFromEnd = FixedWidthCopyFromEnd,
+};
+
+void
+RegisterFixedWidthCopyFormat(void)
+{
+	RegisterCopyCustomFormat("fixedwidth",
+							 &FixedWidthCopyFromRoutine,
+							 &FixedWidthCopyToRoutine);
+}
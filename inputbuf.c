@@ -0,0 +1,333 @@
+/*--------------------------------------------------------------------------
+ *
+ * inputbuf.c
+ *		Buffered input pipeline shared by the text-based COPY FROM formats.
+ *
+ * The data is loaded from the source into input_buf, decompressing it on the
+ * fly if needed, and then transferred into line_buf one line or one
+ * fixed-length record at a time.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		inputbuf.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "commands/copyapi.h"
+#include "commands/copystate.h"
+#include "utils/wait_event.h"
+
+#include "copyprobes.h"
+#include "pg_custom_copy_formats.h"
+
+/*
+ * GZIP support
+ */
+
+static void
+initialize_inflate_gzip(CopyInputBuffer *buf)
+{
+#ifndef HAVE_LIBZ
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("gzip compression is not supported by this build")));
+#else
+
+	MemSet(&buf->strm, 0, sizeof(z_stream));
+	if (inflateInit2(&buf->strm, 15 + 32) != Z_OK)
+		ereport(ERROR,
+				errcode(ERRCODE_INTERNAL_ERROR),
+				errmsg("could not initialize compression library"));
+
+	buf->raw_buf = palloc(RAW_BUF_SIZE + 1);
+	buf->raw_buf_index = buf->raw_buf_len = 0;
+#endif
+}
+
+#ifdef HAVE_LIBZ
+/*
+ * Decompress the next chunk of data into input_buf, which must be empty.
+ * Returns false if the source is exhausted.
+ */
+static bool
+read_gzip(CopyFromState cstate, CopyInputBuffer *buf)
+{
+	Size		written;
+	Size		inbytes;
+	int			ret;
+
+	/* Read compressed data to refill the raw_buf if it's empty */
+	if (RAW_BUF_BYTES(buf) == 0)
+	{
+		buf->raw_buf_len = CopyFromGetData(cstate, buf->raw_buf, 1, RAW_BUF_SIZE);
+		buf->raw_buf_index = 0;
+		cstate->bytes_processed += buf->raw_buf_len;
+		CopyStatsAddBytes(buf->stats, COPY_PHASE_READ, buf->raw_buf_len);
+
+		if (buf->raw_buf_len == 0)
+		{
+			buf->input_buf_len = buf->input_buf_index = 0;
+			return false;
+		}
+	}
+
+	/*
+	 * When decompressing the data, the output buffer could be full before
+	 * reaching the end of raw_buf. Therefore, we keep track of raw_buf_index
+	 * that points the index at which we've fed to the decompression stream.
+	 */
+	inbytes = RAW_BUF_BYTES(buf);
+	buf->strm.next_in = (unsigned char *) (buf->raw_buf + buf->raw_buf_index);
+	buf->strm.avail_in = inbytes;
+
+	/*
+	 * We can always use the whole input_buf as the output buffer of
+	 * decompression since this function is called when the input_buf is
+	 * empty.
+	 */
+	buf->strm.next_out = (unsigned char *) buf->input_buf;
+	buf->strm.avail_out = INPUT_BUF_SIZE;
+
+	(void) CopyStatsSwitch(buf->stats, COPY_PHASE_INFLATE);
+	pgstat_report_wait_start(CopyWaitEventInfo(COPY_WAIT_INFLATE));
+	ret = inflate(&buf->strm, Z_NO_FLUSH);
+	pgstat_report_wait_end();
+	(void) CopyStatsSwitch(buf->stats, COPY_PHASE_READ);
+
+	if (ret < 0 && ret != Z_BUF_ERROR)
+	{
+		inflateEnd(&buf->strm);
+		elog(ERROR, "could not decompress data: %s", buf->strm.msg);
+	}
+
+	/* Continue with the next member of a multi-member gzip file */
+	if (ret == Z_STREAM_END)
+		inflateReset(&buf->strm);
+
+	written = INPUT_BUF_SIZE - buf->strm.avail_out;
+	CopyStatsAddBytes(buf->stats, COPY_PHASE_INFLATE, written);
+	TRACE_COPY_DECOMPRESS_BLOCK((int) (inbytes - buf->strm.avail_in),
+								(int) written);
+
+	/* advance raw_buf_index */
+	buf->raw_buf_index += (inbytes - buf->strm.avail_in);
+
+	/* update input_buf fields */
+	buf->input_buf[written] = '\0';
+	buf->input_buf_len = written;
+	buf->input_buf_index = 0;
+
+	return true;
+}
+#endif
+
+/*
+ * Guess the compression method of the input file from its extension.
+ */
+pg_compress_algorithm
+CopyInputDetectCompression(const char *filename)
+{
+	const char *extension;
+
+	if (filename == NULL)
+		return PG_COMPRESSION_NONE;
+
+	extension = strrchr(filename, '.');
+	if (extension != NULL && strcmp(extension, ".gz") == 0)
+		return PG_COMPRESSION_GZIP;
+
+	return PG_COMPRESSION_NONE;
+}
+
+/*
+ * Allocate buffers for the input pipeline.
+ */
+void
+CopyInputBufferInit(CopyFromState cstate, CopyInputBuffer *buf,
+					pg_compress_algorithm compression)
+{
+	buf->compression = compression;
+
+	if (compression == PG_COMPRESSION_GZIP)
+		initialize_inflate_gzip(buf);
+	else if (compression != PG_COMPRESSION_NONE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("compression algorithm \"%s\" is not supported for COPY FROM",
+						get_compress_algorithm_name(compression))));
+
+	buf->input_buf = palloc(INPUT_BUF_SIZE + 1);
+	buf->input_buf_index = buf->input_buf_len = 0;
+	buf->input_reached_eof = false;
+
+	initStringInfo(&buf->line_buf);
+	cstate->line_buf = &buf->line_buf;
+}
+
+/*
+ * Refill input_buf, which must be empty.  Returns false if no more data is
+ * available.
+ */
+bool
+CopyInputBufferLoad(CopyFromState cstate, CopyInputBuffer *buf)
+{
+	CopyStatsPhase prev;
+
+	Assert(INPUT_BUF_BYTES(buf) <= 0);
+
+	if (buf->input_reached_eof)
+		return false;
+
+	prev = CopyStatsSwitch(buf->stats, COPY_PHASE_READ);
+
+	if (buf->compression == PG_COMPRESSION_NONE)
+	{
+		int			inbytes;
+
+		inbytes = CopyFromGetData(cstate, buf->input_buf, 1, INPUT_BUF_SIZE);
+		buf->input_buf[inbytes] = '\0';
+		buf->input_buf_len = inbytes;
+		buf->input_buf_index = 0;
+		cstate->bytes_processed += inbytes;
+		CopyStatsAddBytes(buf->stats, COPY_PHASE_READ, inbytes);
+	}
+#ifdef HAVE_LIBZ
+	else if (buf->compression == PG_COMPRESSION_GZIP)
+	{
+		/* Decompression may not produce any output for a while */
+		while (INPUT_BUF_BYTES(buf) <= 0 && read_gzip(cstate, buf))
+			;
+	}
+#endif
+
+	(void) CopyStatsSwitch(buf->stats, prev);
+	TRACE_COPY_BUFFER_REFILL(INPUT_BUF_BYTES(buf));
+
+	if (INPUT_BUF_BYTES(buf) <= 0)
+	{
+		buf->input_reached_eof = true;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read one line from the source into line_buf.
+ *
+ * Lines are terminated by '\n', which is not included in line_buf.  The last
+ * line doesn't need to be terminated.  Returns true if we reached EOF without
+ * reading any data.
+ */
+bool
+CopyInputBufferReadLine(CopyFromState cstate, CopyInputBuffer *buf)
+{
+	resetStringInfo(&buf->line_buf);
+
+	for (;;)
+	{
+		char	   *start;
+		char	   *ptr;
+		int			nbytes;
+
+		/* Load more data if needed */
+		if (INPUT_BUF_BYTES(buf) <= 0 && !CopyInputBufferLoad(cstate, buf))
+		{
+			if (buf->line_buf.len == 0)
+				return true;
+			break;
+		}
+
+		start = buf->input_buf + buf->input_buf_index;
+		ptr = memchr(start, '\n', INPUT_BUF_BYTES(buf));
+
+		if (ptr == NULL)
+		{
+			appendBinaryStringInfo(&buf->line_buf, start, INPUT_BUF_BYTES(buf));
+			buf->input_buf_index = buf->input_buf_len;
+			continue;
+		}
+
+		nbytes = ptr - start;
+		appendBinaryStringInfo(&buf->line_buf, start, nbytes);
+
+		/* consume '\n' too */
+		buf->input_buf_index += nbytes + 1;
+		break;
+	}
+
+	cstate->cur_lineno++;
+	TRACE_COPY_LINE_READ(cstate->cur_lineno, buf->line_buf.len);
+
+	return false;
+}
+
+/*
+ * Read a record of exactly 'nbytes' bytes into line_buf.
+ *
+ * Returns true if we reached EOF without reading any data.  If EOF is reached
+ * in the middle of the record, line_buf holds less than 'nbytes' bytes and it
+ * is up to the caller to decide how to handle it.
+ */
+bool
+CopyInputBufferReadBytes(CopyFromState cstate, CopyInputBuffer *buf, int nbytes)
+{
+	resetStringInfo(&buf->line_buf);
+	enlargeStringInfo(&buf->line_buf, nbytes);
+
+	while (buf->line_buf.len < nbytes)
+	{
+		int			n;
+
+		/* Load more data if needed */
+		if (INPUT_BUF_BYTES(buf) <= 0 && !CopyInputBufferLoad(cstate, buf))
+		{
+			if (buf->line_buf.len == 0)
+				return true;
+			break;
+		}
+
+		n = Min(INPUT_BUF_BYTES(buf), nbytes - buf->line_buf.len);
+		appendBinaryStringInfo(&buf->line_buf,
+							   buf->input_buf + buf->input_buf_index, n);
+		buf->input_buf_index += n;
+	}
+
+	cstate->cur_lineno++;
+
+	return false;
+}
+
+/*
+ * Skip the current row after a soft error in the conversion of the value of
+ * 'attname'.  The caller returns the row, and COPY sees the error in
+ * escontext and enforces REJECT_LIMIT.
+ */
+void
+CopyInputSkipRow(CopyFromState cstate, const char *attname)
+{
+	Assert(cstate->escontext != NULL && cstate->escontext->error_occurred);
+
+	cstate->num_errors++;
+
+	if (cstate->opts.log_verbosity == COPY_LOG_VERBOSITY_VERBOSE)
+		ereport(NOTICE,
+				errmsg("skipping row due to data type incompatibility at line %" PRIu64 " for column \"%s\"",
+					   cstate->cur_lineno, attname));
+}
+
+/*
+ * Release the decompression resources.
+ */
+void
+CopyInputBufferEnd(CopyInputBuffer *buf)
+{
+#ifdef HAVE_LIBZ
+	if (buf->compression == PG_COMPRESSION_GZIP)
+		inflateEnd(&buf->strm);
+#endif
+}
@@ -0,0 +1,901 @@
+/*--------------------------------------------------------------------------
+ *
+ * jsondec.c
+ *		JSON to row decoder for the jsonlines formats.
+ *
+ * Each column is fed from a path in the input document.  By default the path
+ * is the top-level key of the column name, and the 'column_paths' option can
+ * map columns to nested values instead, e.g.
+ *
+ *	'user_id=$.user.id, cc=$.user.geo.cc, first_tag=$.tags[0]'
+ *
+ * The paths are compiled into a trie when the decoder is created, so the
+ * common prefixes of the paths are looked up only once per document and
+ * every mapped value is extracted from a single parse of the document.
+ *
+ * If an 'extra_keys_column' is given, the top-level keys that feed no column
+ * are collected into that jsonb column.  Their values are taken from the
+ * already parsed document as they are, without going through text.
+ *
+ * Values are converted to the columns with the input function of the column
+ * type, except that JSON arrays fill array columns and JSON objects fill
+ * composite columns directly, recursing into their elements and fields.
+ * The values converted by input functions are cached per column, see
+ * convcache.c.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		jsondec.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "funcapi.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/jsonb.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
+
+#include "pg_custom_copy_formats.h"
+
+/*
+ * A step of a path.  The children of a node are the steps that follow it in
+ * any of the paths sharing the prefix up to this node.
+ */
+typedef struct JsonLinesPathNode
+{
+	char	   *key;			/* object key, or NULL for an array element */
+	int			keylen;
+	int			index;			/* array subscript if key is NULL */
+	List	   *attnums;		/* columns fed from this value */
+
+	struct JsonLinesPathNode *children;
+	struct JsonLinesPathNode *next;
+} JsonLinesPathNode;
+
+/*
+ * Converter of JSON values into a type.  Array and composite types are
+ * built from JSON arrays and objects, and any other values go through the
+ * input function of the type.
+ */
+typedef enum JsonLinesTypeKind
+{
+	JSONLINES_TYPE_SCALAR,
+	JSONLINES_TYPE_ARRAY,
+	JSONLINES_TYPE_COMPOSITE,
+} JsonLinesTypeKind;
+
+typedef struct JsonLinesTypeConverter
+{
+	JsonLinesTypeKind kind;
+	Oid			typid;
+	int32		typmod;
+	FmgrInfo	infunc;
+	Oid			typioparam;
+
+	/* for arrays */
+	Oid			elemtype;
+	int16		elmlen;
+	bool		elmbyval;
+	char		elmalign;
+	struct JsonLinesTypeConverter *elem;
+
+	/* for composite types, with converters indexed by attnum - 1 */
+	TupleDesc	tupdesc;
+	struct JsonLinesTypeConverter **fields;
+} JsonLinesTypeConverter;
+
+static void
+invalid_column_path(const char *colname, const char *msg)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("invalid JSON path for column \"%s\"", colname),
+			 errdetail("%s", msg)));
+}
+
+/*
+ * Return the child node for the given step from the list 'children',
+ * creating it if needed.
+ */
+static JsonLinesPathNode *
+path_trie_child(JsonLinesPathNode **children, char *key, int keylen, int index)
+{
+	JsonLinesPathNode *node;
+
+	for (node = *children; node != NULL; node = node->next)
+	{
+		if (key != NULL && node->key != NULL && node->keylen == keylen &&
+			memcmp(node->key, key, keylen) == 0)
+			return node;
+		if (key == NULL && node->key == NULL && node->index == index)
+			return node;
+	}
+
+	node = palloc0(sizeof(JsonLinesPathNode));
+	node->key = key;
+	node->keylen = keylen;
+	node->index = index;
+
+	/* Keep the insertion order */
+	while (*children != NULL)
+		children = &(*children)->next;
+	*children = node;
+
+	return node;
+}
+
+/*
+ * Add the path for the column 'attnum' to the trie.
+ */
+static void
+path_trie_insert(JsonLinesPathNode **root, List *steps, int attnum)
+{
+	JsonLinesPathNode **children = root;
+	JsonLinesPathNode *node = NULL;
+	ListCell   *lc;
+
+	foreach(lc, steps)
+	{
+		char	   *step = lfirst(lc);
+
+		/* array subscripts are stored as "[n" */
+		if (step[0] == '[')
+			node = path_trie_child(children, NULL, 0, atoi(step + 1));
+		else
+			node = path_trie_child(children, step, strlen(step), 0);
+
+		children = &node->children;
+	}
+
+	Assert(node != NULL);
+
+	node->attnums = lappend_int(node->attnums, attnum);
+}
+
+/*
+ * Parse a path like $.a."b c"[0].d, returning the list of its steps.  Object
+ * keys are returned as is and array subscripts as "[n".  Parsing stops at
+ * the ',' ending the path or at the end of the string, and *endp is set to
+ * that position.
+ */
+static List *
+parse_column_path(char *p, char **endp, const char *colname)
+{
+	List	   *steps = NIL;
+	bool		first = true;
+
+	while (*p == ' ')
+		p++;
+
+	if (*p == '$')
+	{
+		p++;
+		first = false;
+	}
+
+	for (;;)
+	{
+		StringInfoData step;
+
+		if (*p == '\0' || *p == ',' || *p == ' ')
+			break;
+
+		initStringInfo(&step);
+
+		if (*p == '[')
+		{
+			char	   *end;
+			long		index;
+
+			p++;
+			errno = 0;
+			index = strtol(p, &end, 10);
+			if (end == p || *end != ']' || index < 0 || index > PG_INT32_MAX ||
+				errno != 0)
+				invalid_column_path(colname, "Array subscripts must be non-negative integers.");
+			appendStringInfo(&step, "[%ld", index);
+			p = end + 1;
+		}
+		else
+		{
+			if (*p == '.')
+				p++;
+			else if (!first)
+				invalid_column_path(colname, "Expected \".\" or \"[\".");
+
+			if (*p == '"')
+			{
+				/* quoted key */
+				for (p++;; p++)
+				{
+					if (*p == '\0')
+						invalid_column_path(colname, "Unterminated quoted key.");
+					if (*p == '"')
+						break;
+					if (*p == '\\' && p[1] != '\0')
+						p++;
+					appendStringInfoChar(&step, *p);
+				}
+				p++;
+			}
+			else
+			{
+				while (*p != '\0' && *p != '.' && *p != '[' && *p != ',' &&
+					   *p != ' ' && *p != '"')
+					appendStringInfoChar(&step, *p++);
+
+				if (step.len == 0)
+					invalid_column_path(colname, "Empty key.");
+			}
+		}
+
+		steps = lappend(steps, step.data);
+		first = false;
+	}
+
+	while (*p == ' ')
+		p++;
+
+	if (steps == NIL)
+		invalid_column_path(colname, "The path must have at least one step.");
+
+	*endp = p;
+
+	return steps;
+}
+
+/*
+ * Return the attribute number of the named column if it's decoded.  Returns
+ * 0 if the column exists but is not in the column list, e.g. because a
+ * foreign scan doesn't need it.
+ */
+static int
+decoder_find_column(JsonLinesRowDecoder *dec, const char *colname)
+{
+	int			attnum = CopyFindColumn(dec->attnumlist, dec->tupdesc, colname,
+										false);
+
+	if (attnum != 0)
+		return attnum;
+
+	for (int i = 0; i < dec->tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(dec->tupdesc, i);
+
+		if (!att->attisdropped && strcmp(NameStr(att->attname), colname) == 0)
+			return 0;
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_UNDEFINED_COLUMN),
+			 errmsg("column \"%s\" does not exist", colname)));
+
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Parse the 'column_paths' option into the trie.
+ */
+static void
+parse_column_paths(JsonLinesRowDecoder *dec, char *column_paths,
+				   bool *mapped)
+{
+	char	   *p = pstrdup(column_paths);
+
+	while (*p != '\0')
+	{
+		char	   *colname;
+		char	   *eq;
+		List	   *steps;
+		int			attnum;
+
+		while (*p == ' ' || *p == ',')
+			p++;
+		if (*p == '\0')
+			break;
+
+		eq = strchr(p, '=');
+		if (eq == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid column_paths entry: \"%s\"", p),
+					 errhint("Entries must have the form column=path.")));
+
+		/* column name, with trailing spaces trimmed */
+		colname = p;
+		p = eq + 1;
+		*eq = '\0';
+		while (eq > colname && eq[-1] == ' ')
+			*--eq = '\0';
+
+		attnum = decoder_find_column(dec, colname);
+
+		steps = parse_column_path(p, &p, colname);
+		if (*p != '\0' && *p != ',')
+			invalid_column_path(colname, "Unexpected characters after the path.");
+
+		/* the column is not decoded */
+		if (attnum == 0)
+			continue;
+
+		if (mapped[attnum - 1])
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("column \"%s\" appears more than once in column_paths",
+							colname)));
+		mapped[attnum - 1] = true;
+
+		path_trie_insert(&dec->paths, steps, attnum);
+	}
+}
+
+/*
+ * Create a converter for the given type.  Domains are converted with their
+ * input function.
+ */
+static JsonLinesTypeConverter *
+create_type_converter(Oid typid, int32 typmod)
+{
+	JsonLinesTypeConverter *conv = palloc0(sizeof(JsonLinesTypeConverter));
+	Oid			func_oid;
+
+	conv->typid = typid;
+	conv->typmod = typmod;
+	getTypeInputInfo(typid, &func_oid, &conv->typioparam);
+	fmgr_info(func_oid, &conv->infunc);
+
+	conv->elemtype = get_element_type(typid);
+	if (OidIsValid(conv->elemtype))
+	{
+		conv->kind = JSONLINES_TYPE_ARRAY;
+		get_typlenbyvalalign(conv->elemtype, &conv->elmlen, &conv->elmbyval,
+							 &conv->elmalign);
+
+		/* the typmod of an array applies to its elements */
+		conv->elem = create_type_converter(conv->elemtype, typmod);
+	}
+	else if (get_typtype(typid) == TYPTYPE_COMPOSITE)
+	{
+		conv->kind = JSONLINES_TYPE_COMPOSITE;
+		conv->tupdesc = lookup_rowtype_tupdesc_copy(typid, typmod);
+		conv->fields = palloc0(sizeof(JsonLinesTypeConverter *) *
+							   Max(conv->tupdesc->natts, 1));
+
+		for (int i = 0; i < conv->tupdesc->natts; i++)
+		{
+			Form_pg_attribute att = TupleDescAttr(conv->tupdesc, i);
+
+			if (att->attisdropped)
+				continue;
+			conv->fields[i] = create_type_converter(att->atttypid,
+													att->atttypmod);
+		}
+	}
+	else
+		conv->kind = JSONLINES_TYPE_SCALAR;
+
+	return conv;
+}
+
+/*
+ * Create a decoder for the given columns of the tuple descriptor.
+ *
+ * 'in_functions' and 'typioparams' are the input functions of the columns
+ * indexed by attribute number - 1, or NULL to look them up here.
+ * 'column_paths' and 'extra_keys_column' are the option values or NULL.
+ */
+JsonLinesRowDecoder *
+JsonLinesCreateRowDecoder(TupleDesc tupdesc, List *attnumlist,
+						  FmgrInfo *in_functions, Oid *typioparams,
+						  char *column_paths, char *extra_keys_column)
+{
+	JsonLinesRowDecoder *dec = palloc0(sizeof(JsonLinesRowDecoder));
+	bool	   *mapped = palloc0(sizeof(bool) * Max(tupdesc->natts, 1));
+	ListCell   *lc;
+
+	dec->tupdesc = tupdesc;
+	dec->attnumlist = attnumlist;
+	initStringInfo(&dec->buf);
+
+	if (in_functions == NULL)
+	{
+		in_functions = palloc0(sizeof(FmgrInfo) * Max(tupdesc->natts, 1));
+		typioparams = palloc0(sizeof(Oid) * Max(tupdesc->natts, 1));
+
+		foreach(lc, attnumlist)
+		{
+			int			attnum = lfirst_int(lc);
+			Oid			func_oid;
+
+			getTypeInputInfo(TupleDescAttr(tupdesc, attnum - 1)->atttypid,
+							 &func_oid, &typioparams[attnum - 1]);
+			fmgr_info(func_oid, &in_functions[attnum - 1]);
+		}
+	}
+
+	dec->in_functions = in_functions;
+	dec->typioparams = typioparams;
+
+	/*
+	 * Array and composite columns are built from the JSON values, and the
+	 * other columns have a cache of converted values.
+	 */
+	dec->converters = palloc0(sizeof(JsonLinesTypeConverter *) *
+							  Max(tupdesc->natts, 1));
+	dec->caches = palloc0(sizeof(CopyConvCache *) * Max(tupdesc->natts, 1));
+	foreach(lc, attnumlist)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, lfirst_int(lc) - 1);
+
+		if (OidIsValid(get_element_type(att->atttypid)) ||
+			get_typtype(att->atttypid) == TYPTYPE_COMPOSITE)
+			dec->converters[att->attnum - 1] =
+				create_type_converter(att->atttypid, att->atttypmod);
+		else
+			dec->caches[att->attnum - 1] = CopyConvCacheCreate(att->atttypid);
+	}
+
+	if (extra_keys_column != NULL)
+		dec->extra_attnum = decoder_find_column(dec, extra_keys_column);
+
+	if (dec->extra_attnum != 0)
+	{
+		if (TupleDescAttr(tupdesc, dec->extra_attnum - 1)->atttypid != JSONBOID)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("extra_keys_column \"%s\" must be of type jsonb",
+							extra_keys_column)));
+
+		/* the extra keys column is not fed from a key */
+		mapped[dec->extra_attnum - 1] = true;
+	}
+
+	if (column_paths != NULL)
+		parse_column_paths(dec, column_paths, mapped);
+
+	/* The other columns come from the top-level key of the same name */
+	foreach(lc, attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		char	   *attname = NameStr(TupleDescAttr(tupdesc, attnum - 1)->attname);
+
+		if (mapped[attnum - 1])
+			continue;
+
+		path_trie_insert(&dec->paths, list_make1(attname), attnum);
+	}
+
+	/* Top-level keys that are known, to find the extra keys */
+	if (dec->extra_attnum != 0)
+	{
+		int			nkeys = 0;
+
+		for (JsonLinesPathNode *node = dec->paths; node != NULL; node = node->next)
+			nkeys++;
+
+		dec->known_keys = CopyKeyMapCreate(nkeys);
+		for (JsonLinesPathNode *node = dec->paths; node != NULL; node = node->next)
+		{
+			if (node->key != NULL)
+				CopyKeyMapInsert(dec->known_keys, node->key, node->keylen, 1);
+		}
+	}
+
+	pfree(mapped);
+
+	return dec;
+}
+
+/*
+ * Write a C-string representation of the given JsonbValue to 'str'.
+ */
+static void
+GetJsonbValueAsCString(JsonbValue *v, StringInfo str)
+{
+	switch (v->type)
+	{
+		case jbvNull:
+			/* must be handled by the caller */
+			break;
+
+		case jbvBool:
+			appendStringInfoString(str, v->val.boolean ? "true" : "false");
+			break;
+
+		case jbvString:
+			appendBinaryStringInfo(str, v->val.string.val, v->val.string.len);
+			break;
+		case jbvNumeric:
+			{
+				Datum		cstr;
+
+				cstr = DirectFunctionCall1(numeric_out,
+										   PointerGetDatum(v->val.numeric));
+
+				appendStringInfoString(str, DatumGetCString(cstr));
+				break;
+			}
+
+		case jbvBinary:
+			(void) JsonbToCString(str, v->val.binary.data, v->val.binary.len);
+			break;
+
+		default:
+			elog(ERROR, "unrecognized jsonb type: %d", (int) v->type);
+	}
+
+	return;
+}
+
+static bool convert_value(JsonLinesRowDecoder *dec,
+						  JsonLinesTypeConverter *conv, JsonbValue *v,
+						  Datum *result, Node *escontext);
+
+/*
+ * Collect the elements of the dimension 'dim' of a JSON array, checking that
+ * the sub-arrays have the expected dimensions.
+ */
+static bool
+convert_array_dim(JsonLinesRowDecoder *dec, JsonLinesTypeConverter *conv,
+				  JsonbContainer *jc, int dim, int ndim, int *dims,
+				  Datum *elems, bool *elemnulls, int *nelems, Node *escontext)
+{
+	if (JsonContainerSize(jc) != dims[dim])
+		ereturn(escontext, false,
+				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+				 errmsg("multidimensional arrays must have sub-arrays with matching dimensions")));
+
+	for (int i = 0; i < dims[dim]; i++)
+	{
+		JsonbValue *v = getIthJsonbValueFromContainer(jc, i);
+
+		if (dim < ndim - 1)
+		{
+			if (v->type != jbvBinary ||
+				!JsonContainerIsArray(v->val.binary.data) ||
+				JsonContainerIsScalar(v->val.binary.data))
+				ereturn(escontext, false,
+						(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+						 errmsg("multidimensional arrays must have sub-arrays with matching dimensions")));
+
+			if (!convert_array_dim(dec, conv, v->val.binary.data, dim + 1,
+								   ndim, dims, elems, elemnulls, nelems,
+								   escontext))
+				return false;
+			continue;
+		}
+
+		if (v->type == jbvNull)
+		{
+			elems[*nelems] = (Datum) 0;
+			elemnulls[*nelems] = true;
+		}
+		else
+		{
+			if (!convert_value(dec, conv->elem, v, &elems[*nelems], escontext))
+				return false;
+			elemnulls[*nelems] = false;
+		}
+		(*nelems)++;
+	}
+
+	return true;
+}
+
+/*
+ * Build an array from a JSON array.  Nested JSON arrays make the dimensions,
+ * which are taken from the first elements at each level.
+ */
+static bool
+convert_array(JsonLinesRowDecoder *dec, JsonLinesTypeConverter *conv,
+			  JsonbContainer *jc, Datum *result, Node *escontext)
+{
+	int			dims[MAXDIM];
+	int			lbs[MAXDIM];
+	int			ndim = 0;
+	int			nitems;
+	int			nelems = 0;
+	Datum	   *elems;
+	bool	   *elemnulls;
+
+	for (JsonbContainer *c = jc;;)
+	{
+		JsonbValue *first;
+
+		if (ndim == MAXDIM)
+			ereturn(escontext, false,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("number of array dimensions exceeds the maximum allowed (%d)",
+							MAXDIM)));
+
+		dims[ndim] = JsonContainerSize(c);
+		lbs[ndim] = 1;
+		ndim++;
+
+		if (dims[ndim - 1] == 0)
+			break;
+
+		first = getIthJsonbValueFromContainer(c, 0);
+		if (first->type != jbvBinary ||
+			!JsonContainerIsArray(first->val.binary.data) ||
+			JsonContainerIsScalar(first->val.binary.data))
+			break;
+		c = first->val.binary.data;
+	}
+
+	nitems = ArrayGetNItems(ndim, dims);
+	if (nitems == 0)
+	{
+		*result = PointerGetDatum(construct_empty_array(conv->elemtype));
+		return true;
+	}
+
+	elems = palloc(sizeof(Datum) * nitems);
+	elemnulls = palloc(sizeof(bool) * nitems);
+
+	if (!convert_array_dim(dec, conv, jc, 0, ndim, dims, elems, elemnulls,
+						   &nelems, escontext))
+		return false;
+
+	*result = PointerGetDatum(construct_md_array(elems, elemnulls, ndim, dims,
+												 lbs, conv->elemtype,
+												 conv->elmlen, conv->elmbyval,
+												 conv->elmalign));
+	return true;
+}
+
+/*
+ * Build a composite value from a JSON object, filling each field from the
+ * key of the same name.  Missing fields are NULL.
+ */
+static bool
+convert_composite(JsonLinesRowDecoder *dec, JsonLinesTypeConverter *conv,
+				  JsonbContainer *jc, Datum *result, Node *escontext)
+{
+	TupleDesc	tupdesc = conv->tupdesc;
+	Datum	   *values = palloc(sizeof(Datum) * Max(tupdesc->natts, 1));
+	bool	   *nulls = palloc(sizeof(bool) * Max(tupdesc->natts, 1));
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		JsonbValue	vbuf;
+		JsonbValue *v;
+
+		nulls[i] = true;
+
+		if (att->attisdropped)
+			continue;
+
+		v = getKeyJsonValueFromContainer(jc, NameStr(att->attname),
+										 strlen(NameStr(att->attname)), &vbuf);
+		if (v == NULL || v->type == jbvNull)
+			continue;
+
+		if (!convert_value(dec, conv->fields[i], v, &values[i], escontext))
+			return false;
+		nulls[i] = false;
+	}
+
+	*result = HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
+
+	return true;
+}
+
+/*
+ * Convert the non-null JSON value 'v' with the converter.  Returns false on
+ * a soft error.
+ */
+static bool
+convert_value(JsonLinesRowDecoder *dec, JsonLinesTypeConverter *conv,
+			  JsonbValue *v, Datum *result, Node *escontext)
+{
+	if (v->type == jbvBinary)
+	{
+		JsonbContainer *jc = v->val.binary.data;
+
+		if (conv->kind == JSONLINES_TYPE_ARRAY &&
+			JsonContainerIsArray(jc) && !JsonContainerIsScalar(jc))
+			return convert_array(dec, conv, jc, result, escontext);
+
+		if (conv->kind == JSONLINES_TYPE_COMPOSITE && JsonContainerIsObject(jc))
+			return convert_composite(dec, conv, jc, result, escontext);
+	}
+
+	/* Otherwise the value is given to the input function as text */
+	resetStringInfo(&dec->buf);
+	GetJsonbValueAsCString(v, &dec->buf);
+
+	return InputFunctionCallSafe(&conv->infunc, dec->buf.data,
+								 conv->typioparam, conv->typmod, escontext,
+								 result);
+}
+
+/*
+ * Convert the jsonb value 'v' into the column 'attnum'.  'v' may be NULL,
+ * meaning the value is missing.
+ *
+ * Returns false if the conversion failed with a soft error reported to
+ * 'escontext', remembering the column in error_attnum.
+ */
+bool
+JsonLinesDecodeValue(JsonLinesRowDecoder *dec, int attnum, JsonbValue *v,
+					 Datum *values, bool *nulls, Node *escontext)
+{
+	Form_pg_attribute att = TupleDescAttr(dec->tupdesc, attnum - 1);
+	CopyConvCache *cache;
+	uint32		hash = 0;
+
+	/*
+	 * Fill with NULL if either not found or the value represent NULL.
+	 */
+	if (v == NULL || v->type == jbvNull)
+	{
+		nulls[attnum - 1] = true;
+		return true;
+	}
+
+	nulls[attnum - 1] = false;
+
+	if (dec->converters[attnum - 1] != NULL)
+	{
+		if (!convert_value(dec, dec->converters[attnum - 1], v,
+						   &values[attnum - 1], escontext))
+		{
+			dec->error_attnum = attnum;
+			return false;
+		}
+		return true;
+	}
+
+	/* Convert the jsonb value to cstring */
+	resetStringInfo(&dec->buf);
+	GetJsonbValueAsCString(v, &dec->buf);
+
+	cache = dec->caches[attnum - 1];
+	if (cache != NULL &&
+		CopyConvCacheLookup(cache, dec->buf.data, dec->buf.len, &hash,
+							&values[attnum - 1]))
+		return true;
+
+	/* Convert the cstring data into the column */
+	if (!InputFunctionCallSafe(&dec->in_functions[attnum - 1],
+							   dec->buf.data,
+							   dec->typioparams[attnum - 1],
+							   att->atttypmod,
+							   escontext,
+							   &values[attnum - 1]))
+	{
+		dec->error_attnum = attnum;
+		return false;
+	}
+
+	if (cache != NULL)
+		CopyConvCacheInsert(cache, dec->buf.data, dec->buf.len, hash,
+							values[attnum - 1]);
+
+	return true;
+}
+
+/*
+ * Fill the columns fed from the children of a path node.  Returns false on
+ * a soft error.
+ */
+static bool
+decode_path_children(JsonLinesRowDecoder *dec, JsonbContainer *container,
+					 JsonLinesPathNode *children, Datum *values, bool *nulls,
+					 Node *escontext)
+{
+	for (JsonLinesPathNode *node = children; node != NULL; node = node->next)
+	{
+		JsonbValue	vbuf;
+		JsonbValue *v = NULL;
+
+		if (node->key != NULL)
+		{
+			if (JsonContainerIsObject(container))
+				v = getKeyJsonValueFromContainer(container, node->key,
+												 node->keylen, &vbuf);
+		}
+		else if (JsonContainerIsArray(container) &&
+				 !JsonContainerIsScalar(container))
+			v = getIthJsonbValueFromContainer(container, node->index);
+
+		foreach_int(attnum, node->attnums)
+		{
+			if (!JsonLinesDecodeValue(dec, attnum, v, values, nulls, escontext))
+				return false;
+		}
+
+		if (node->children != NULL && v != NULL && v->type == jbvBinary &&
+			!decode_path_children(dec, v->val.binary.data, node->children,
+								  values, nulls, escontext))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Collect the top-level pairs whose key feeds no column into the extra keys
+ * column.  The column is left NULL if there are none.
+ */
+static void
+decode_extra_keys(JsonLinesRowDecoder *dec, Jsonb *jb, Datum *values,
+				  bool *nulls)
+{
+	JsonbParseState *state = NULL;
+	JsonbIterator *it;
+	JsonbIteratorToken tok;
+	JsonbValue	key;
+	JsonbValue	val;
+	JsonbValue *res;
+
+	(void) pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	it = JsonbIteratorInit(&jb->root);
+	while ((tok = JsonbIteratorNext(&it, &key, true)) != WJB_DONE)
+	{
+		if (tok != WJB_KEY)
+			continue;
+
+		/* nested containers come back as jbvBinary and are copied from it */
+		tok = JsonbIteratorNext(&it, &val, true);
+		Assert(tok == WJB_VALUE);
+
+		if (CopyKeyMapLookup(dec->known_keys, key.val.string.val,
+							 key.val.string.len) != 0)
+			continue;
+
+		(void) pushJsonbValue(&state, WJB_KEY, &key);
+		(void) pushJsonbValue(&state, WJB_VALUE, &val);
+	}
+
+	res = pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+
+	if (res->val.object.nPairs > 0)
+	{
+		values[dec->extra_attnum - 1] = JsonbPGetDatum(JsonbValueToJsonb(res));
+		nulls[dec->extra_attnum - 1] = false;
+	}
+}
+
+/*
+ * Fill the columns from the document 'jb', which must be an object.  The
+ * columns whose path is missing in the document are set to NULL.
+ *
+ * Returns false on a soft error reported to 'escontext'.  error_attnum is
+ * then the column that failed to convert, or 0 if the document itself is
+ * invalid.
+ */
+bool
+JsonLinesDecodeRow(JsonLinesRowDecoder *dec, Jsonb *jb, Datum *values,
+				   bool *nulls, Node *escontext)
+{
+	ListCell   *lc;
+
+	dec->error_attnum = 0;
+
+	if (!JB_ROOT_IS_OBJECT(jb))
+		ereturn(escontext, false,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("jsonlines row must be a JSON object")));
+
+	foreach(lc, dec->attnumlist)
+		nulls[lfirst_int(lc) - 1] = true;
+
+	if (!decode_path_children(dec, &jb->root, dec->paths, values, nulls,
+							  escontext))
+		return false;
+
+	if (dec->extra_attnum != 0)
+		decode_extra_keys(dec, jb, values, nulls);
+
+	return true;
+}
@@ -0,0 +1,195 @@
+/*--------------------------------------------------------------------------
+ *
+ * jsonenc.c
+ *		Row to JSON encoder for the jsonlines formats.
+ *
+ * The encoder is set up once per tuple descriptor: each column's JSON type
+ * category and output function are looked up, and the escaped key of each
+ * column is built in advance, so encoding a row needs no catalog lookups and
+ * no per-row key escaping.  The output is the same as row_to_json().
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		jsonenc.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "common/jsonapi.h"
+#include "utils/builtins.h"
+#include "utils/json.h"
+#include "utils/jsonb.h"
+#include "utils/lsyscache.h"
+
+#include "pg_custom_copy_formats.h"
+
+/*
+ * Create an encoder for the given columns of the tuple descriptor.
+ */
+JsonLinesRowEncoder *
+JsonLinesCreateRowEncoder(TupleDesc tupdesc, List *attnumlist)
+{
+	JsonLinesRowEncoder *enc = palloc0(sizeof(JsonLinesRowEncoder));
+	StringInfoData keybuf;
+	ListCell   *lc;
+	int			i = 0;
+
+	enc->ncolumns = list_length(attnumlist);
+	enc->columns = palloc0(sizeof(JsonLinesColumnEncoder) * Max(enc->ncolumns, 1));
+
+	initStringInfo(&keybuf);
+
+	foreach(lc, attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		Form_pg_attribute att = TupleDescAttr(tupdesc, attnum - 1);
+		JsonLinesColumnEncoder *col = &enc->columns[i++];
+
+		col->attnum = attnum;
+
+		json_categorize_type(att->atttypid, false, &col->tcategory,
+							 &col->outfuncoid);
+
+		/* Print jsonb directly rather than through its output function */
+		if (col->tcategory == JSONTYPE_JSON &&
+			getBaseType(att->atttypid) == JSONBOID)
+			col->tcategory = JSONTYPE_JSONB;
+		if (col->tcategory != JSONTYPE_CAST && OidIsValid(col->outfuncoid))
+			fmgr_info(col->outfuncoid, &col->outfunc);
+
+		resetStringInfo(&keybuf);
+		escape_json(&keybuf, NameStr(att->attname));
+		appendStringInfoChar(&keybuf, ':');
+		col->key = pstrdup(keybuf.data);
+		col->keylen = keybuf.len;
+	}
+
+	pfree(keybuf.data);
+
+	return enc;
+}
+
+/*
+ * Append the JSON representation of a non-null value to 'buf'.
+ */
+void
+JsonLinesEncodeDatum(JsonLinesColumnEncoder *col, Datum value, StringInfo buf)
+{
+	switch (col->tcategory)
+	{
+		case JSONTYPE_NULL:
+			appendBinaryStringInfo(buf, "null", 4);
+			break;
+
+		case JSONTYPE_BOOL:
+			if (DatumGetBool(value))
+				appendBinaryStringInfo(buf, "true", 4);
+			else
+				appendBinaryStringInfo(buf, "false", 5);
+			break;
+
+		case JSONTYPE_NUMERIC:
+			{
+				char	   *str = OutputFunctionCall(&col->outfunc, value);
+
+				/* NaN and infinities are not valid JSON numbers */
+				if (IsValidJsonNumber(str, strlen(str)))
+					appendStringInfoString(buf, str);
+				else
+					escape_json(buf, str);
+				break;
+			}
+
+		case JSONTYPE_JSON:
+			appendStringInfoString(buf, OutputFunctionCall(&col->outfunc, value));
+			break;
+
+		case JSONTYPE_JSONB:
+			{
+				Jsonb	   *jb = DatumGetJsonbP(value);
+
+				(void) JsonbToCString(buf, &jb->root, VARSIZE(jb));
+				break;
+			}
+
+		case JSONTYPE_OTHER:
+			escape_json(buf, OutputFunctionCall(&col->outfunc, value));
+			break;
+
+		default:
+			{
+				/* dates, arrays, composites and casts */
+				text	   *json = DatumGetTextPP(datum_to_json(value,
+																col->tcategory,
+																col->outfuncoid));
+
+				appendBinaryStringInfo(buf, VARDATA_ANY(json),
+									   VARSIZE_ANY_EXHDR(json));
+				break;
+			}
+	}
+}
+
+/*
+ * Append the row as a JSON object to 'buf'.  If enc->omit_nulls is set, keys
+ * with NULL values are left out.
+ */
+void
+JsonLinesEncodeRow(JsonLinesRowEncoder *enc, Datum *values, bool *nulls,
+				   StringInfo buf)
+{
+	bool		first = true;
+
+	appendStringInfoCharMacro(buf, '{');
+
+	for (int i = 0; i < enc->ncolumns; i++)
+	{
+		JsonLinesColumnEncoder *col = &enc->columns[i];
+		int			m = col->attnum - 1;
+
+		if (nulls[m] && enc->omit_nulls)
+			continue;
+
+		if (!first)
+			appendStringInfoCharMacro(buf, ',');
+		first = false;
+
+		appendBinaryStringInfo(buf, col->key, col->keylen);
+
+		if (nulls[m])
+			appendBinaryStringInfo(buf, "null", 4);
+		else
+			JsonLinesEncodeDatum(col, values[m], buf);
+	}
+
+	appendStringInfoCharMacro(buf, '}');
+}
+
+/*
+ * Append the row as a JSON array of the column values to 'buf'.
+ */
+void
+JsonLinesEncodeRowArray(JsonLinesRowEncoder *enc, Datum *values, bool *nulls,
+						StringInfo buf)
+{
+	appendStringInfoCharMacro(buf, '[');
+
+	for (int i = 0; i < enc->ncolumns; i++)
+	{
+		JsonLinesColumnEncoder *col = &enc->columns[i];
+		int			m = col->attnum - 1;
+
+		if (i > 0)
+			appendStringInfoCharMacro(buf, ',');
+
+		if (nulls[m])
+			appendBinaryStringInfo(buf, "null", 4);
+		else
+			JsonLinesEncodeDatum(col, values[m], buf);
+	}
+
+	appendStringInfoCharMacro(buf, ']');
+}
@@ -17,16 +17,22 @@
 #include "commands/copystate.h"
 #include "commands/defrem.h"
 #include "common/compression.h"
+#include "executor/executor.h"
 #include "funcapi.h"
+#include "optimizer/optimizer.h"
+#include "rewrite/rewriteHandler.h"
 #include "utils/builtins.h"
+#include "utils/json.h"
 #include "utils/jsonb.h"
 #include "utils/lsyscache.h"
 #include "utils/fmgroids.h"
+#include "utils/wait_event.h"
 
 #ifdef HAVE_LIBZ
 #include "zlib.h"
 #endif
 
+#include "copyprobes.h"
 #include "pg_custom_copy_formats.h"
 
 PG_MODULE_MAGIC;
@@ -44,6 +50,10 @@ typedef struct JsonLinesOptions
 	pg_compress_specification compression_specification;
 
 	char	*compression_detail_str;
+
+	bool		omit_nulls;		/* skip keys of NULL values in COPY TO */
+	bool		stats;			/* report per-phase statistics */
+	bool		stats_no_timing;	/* 'stats_timing false' */
 } JsonLinesOptions;
 
 typedef struct CopyToStateJsonLines
@@ -52,6 +62,12 @@ typedef struct CopyToStateJsonLines
 
 	JsonLinesOptions options;
 
+	/* true for jsonlines_compact format */
+	bool		compact;
+	JsonLinesRowEncoder *encoder;
+	StringInfoData rowbuf;
+	CopyStats  *stats;			/* NULL unless the 'stats' option is given */
+
 #ifdef HAVE_LIBZ
 	z_stream	strm;
 	StringInfoData	inbuf;
@@ -59,41 +75,74 @@ typedef struct CopyToStateJsonLines
 #endif
 } CopyToStateJsonLines;
 
+/*
+ * How the input is split into documents for COPY FROM.
+ */
+typedef enum JsonLinesMode
+{
+	JSONLINES_MODE_LINES,		/* one document per line (default) */
+	JSONLINES_MODE_ARRAY,		/* elements of a single top-level array */
+	JSONLINES_MODE_SEQ,			/* concatenated documents */
+} JsonLinesMode;
+
+/* Position within the top-level array in JSONLINES_MODE_ARRAY */
+typedef enum JsonArrayState
+{
+	JSON_ARRAY_BEFORE,			/* expecting '[' */
+	JSON_ARRAY_FIRST,			/* expecting the first element or ']' */
+	JSON_ARRAY_NEXT,			/* expecting ',' or ']' */
+	JSON_ARRAY_ELEMENT,			/* expecting an element after ',' */
+	JSON_ARRAY_DONE,			/* seen ']' */
+} JsonArrayState;
+
 typedef struct CopyFromStateJsonLines
 {
 	CopyFromStateData base;
 
-	pg_compress_algorithm compression;
+	JsonLinesMode mode;
+	JsonArrayState array_state;
 
-#ifdef HAVE_LIBZ
-	z_stream	strm;
-	StringInfoData	inbuf;
-	unsigned char	outbuf[GZIP_CHUNK_SIZE];
+	char	   *column_paths;	/* column_paths option */
+	char	   *extra_keys_column;	/* extra_keys_column option */
+	JsonLinesRowDecoder *decoder;
 
-#define RAW_BUF_SIZE 65536      /* we palloc RAW_BUF_SIZE+1 bytes */
-    char       *raw_buf;
-    int         raw_buf_index;  /* next byte to process */
-    int         raw_buf_len;    /* total # of bytes stored */
-    /* Shorthand for number of unconsumed bytes available in raw_buf */
-#define RAW_BUF_BYTES(cstate) ((cstate)->raw_buf_len - (cstate)->raw_buf_index)
-#endif
+	/*
+	 * Routing of the documents to other tables by the 'route_key' and
+	 * 'routes' options.  The documents are parsed in line_cxt, which is reset
+	 * for each document.
+	 */
+	char	   *route_key;
+	char	   *routes;
+	JsonLinesRouter *router;
+	MemoryContext line_cxt;
 
 	/*
-	 * XXX All following fields are borrowed from CopyFromStateBuiltins, which
-	 * are for builtin formats such as text and CSV since reading text-based
-	 * data is the common routine also for this jsonlines format.
+	 * With the 'document_column' option, each document is stored as a whole
+	 * into that column, and the other columns get their default values.
 	 */
+	char	   *document_column;
+	int			document_attnum;
+	ExprState **document_defexprs;	/* indexed by attnum - 1 */
+
+	bool		collect_stats;	/* 'stats' option */
+	bool		stats_no_timing;	/* 'stats_timing false' */
 
-    StringInfoData line_buf;
+	/* Table to record the rows skipped by ON_ERROR ignore, if any */
+	char	   *error_table;
+	CopyErrorTable *errtab;
+
+	/*
+	 * For jsonlines_compact format, the attribute number of each position of
+	 * the row arrays, taken from the header line.  0 means the position is
+	 * not loaded.
+	 */
+	bool		compact;
+	bool		header_read;
+	int		   *header_attnums;
+	int			header_ncolumns;
 
-#define INPUT_BUF_SIZE 65536    /* we palloc INPUT_BUF_SIZE+1 bytes */
-    char       *input_buf;
-    int         input_buf_index;    /* next byte to process */
-    int         input_buf_len;  /* total # of bytes stored */
-    bool        input_reached_eof;  /* true if we reached EOF */
-    bool        input_reached_error;    /* true if a conversion error happened */
-    /* Shorthand for number of unconsumed bytes available in input_buf */
-#define INPUT_BUF_BYTES(cstate) ((cstate)->input_buf_len - (cstate)->input_buf_index)
+	/* Input pipeline shared with the other text-based formats */
+	CopyInputBuffer input;
 } CopyFromStateJsonLines;
 
 static void JsonLinesCopyFromInFunc(CopyFromState cstate, Oid atttypid, FmgrInfo *finfo,
@@ -129,23 +178,6 @@ initialize_deflate_gzip(z_stream *strm, pg_compress_specification *spec)
 #endif
 }
 
-static void
-initialize_inflate_gzip(z_stream *strm)
-{
-#ifndef HAVE_LIBZ
-	ereport(ERROR,
-			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-			 errmsg("gzip compression is not supported by this build")));
-#else
-
-	MemSet(strm, 0, sizeof(z_stream));
-	if (inflateInit2(strm,15 + 32) != Z_OK)
-		ereport(ERROR,
-				errcode(ERRCODE_INTERNAL_ERROR),
-				errmsg("could not initialize compression library"));
-#endif
-}
-
 #ifdef HAVE_LIBZ
 static void
 write_gzip(CopyToStateJsonLines *cstate, char *rowdata, int flush_flag)
@@ -154,158 +186,251 @@ write_gzip(CopyToStateJsonLines *cstate, char *rowdata, int flush_flag)
 
 	cstate->strm.next_in = (unsigned char *) rowdata;
 	cstate->strm.avail_in = row_len;
+	CopyStatsAddBytes(cstate->stats, COPY_PHASE_DEFLATE, row_len);
 
 	do
 	{
 		Size	written;
+		int		ret;
 
 		cstate->strm.next_out = cstate->outbuf;
 		cstate->strm.avail_out = GZIP_CHUNK_SIZE;
 
-		if (deflate(&cstate->strm, flush_flag) == Z_STREAM_ERROR)
+		(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_DEFLATE);
+		pgstat_report_wait_start(CopyWaitEventInfo(COPY_WAIT_DEFLATE));
+		ret = deflate(&cstate->strm, flush_flag);
+		pgstat_report_wait_end();
+		if (ret == Z_STREAM_ERROR)
 			elog(ERROR, "could not compress data: %s", cstate->strm.msg);
 
 		written = GZIP_CHUNK_SIZE - cstate->strm.avail_out;
 
+		TRACE_COPY_COMPRESS_BLOCK((int) (row_len - cstate->strm.avail_in),
+								  (int) written);
+		row_len = cstate->strm.avail_in;
+
 		if (written > 0)
 		{
+			TRACE_COPY_FLUSH((int) written);
 			appendBinaryStringInfo(cstate->base.fe_msgbuf, cstate->outbuf, written);
+			(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_WRITE);
+			CopyStatsAddBytes(cstate->stats, COPY_PHASE_WRITE, written);
 			CopyToFlushData((CopyToState) cstate);
 		}
 	}
 	while (cstate->strm.avail_out == 0);
 }
 
-static void
-read_gzip(CopyFromStateJsonLines *cstate)
-{
-	Size	written;
-	Size	inbytes;
-
-	/* Read compressed data to refill the raw_buf if it's empty */
-	if (RAW_BUF_BYTES(cstate) == 0)
-	{
-		cstate->raw_buf_len = CopyFromGetData((CopyFromState) cstate, cstate->raw_buf, 1, RAW_BUF_SIZE);
-		cstate->raw_buf_index = 0;
-		cstate->base.bytes_processed += cstate->raw_buf_len;
-	}
-
-	/*
-	 * When decompressing the data, the output buffer could be full before reaching
-	 * the end of raw_buf. Therefore, we keep track of raw_buf_index that points the
-	 * index at which we've fed to the decompression stream.
-	 */
-	inbytes = RAW_BUF_BYTES(cstate);
-	cstate->strm.next_in = (unsigned char *) (cstate->raw_buf + cstate->raw_buf_index);
-	cstate->strm.avail_in = inbytes;
-
-	/*
-	 * We can always use the whole input_buf as the output buffer of decompression
-	 * since this function is called when the input_buf is empty.
-	 */
-	cstate->strm.next_out = (unsigned char *) cstate->input_buf;
-	cstate->strm.avail_out = INPUT_BUF_SIZE;
-
-	if (inflate(&cstate->strm, Z_NO_FLUSH) < 0)
-	{
-		inflateEnd(&cstate->strm);
-		elog(ERROR, "could not decompress data: %s", cstate->strm.msg);
-	}
-
-	written = INPUT_BUF_SIZE - cstate->strm.avail_out;
-
-	/* advance raw_buf_index */
-	cstate->raw_buf_index += (inbytes - cstate->strm.avail_in);
-
-	/* update input_buf fields */
-	cstate->input_buf[written] = '\0';
-	cstate->input_buf_len = written;
-	cstate->input_buf_index = 0;
-}
-
 static void
 end_deflate_gzip(CopyToStateJsonLines *cstate)
 {
 	write_gzip(cstate, "", Z_FINISH);
 	deflateEnd(&cstate->strm);
 }
+#endif
 
 static void
-end_inflate_gzip(CopyFromStateJsonLines *cstate)
+json_document_error(const char *msg)
 {
-	inflateEnd(&cstate->strm);
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+			 errmsg("invalid input syntax for type %s", "json"),
+			 errdetail("%s", msg)));
+}
+
+/*
+ * Skip whitespace and the separators between top-level documents.  Returns
+ * the position of the first byte of the next document, or 'end'.
+ */
+static char *
+JsonDocSkipSeparators(CopyFromStateJsonLines *cstate, char *p, char *end)
+{
+	for (; p < end; p++)
+	{
+		char		c = *p;
+
+		/* RFC 7464 JSON text sequences prefix each document with RS */
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\x1e')
+			continue;
+
+		if (cstate->mode != JSONLINES_MODE_ARRAY)
+			return p;
+
+		switch (cstate->array_state)
+		{
+			case JSON_ARRAY_BEFORE:
+				if (c != '[')
+					json_document_error("Input data must be a JSON array.");
+				cstate->array_state = JSON_ARRAY_FIRST;
+				break;
+			case JSON_ARRAY_FIRST:
+				if (c == ']')
+					cstate->array_state = JSON_ARRAY_DONE;
+				else
+					return p;
+				break;
+			case JSON_ARRAY_NEXT:
+				if (c == ',')
+					cstate->array_state = JSON_ARRAY_ELEMENT;
+				else if (c == ']')
+					cstate->array_state = JSON_ARRAY_DONE;
+				else
+					json_document_error("Expected \",\" or \"]\" after array element.");
+				break;
+			case JSON_ARRAY_ELEMENT:
+				if (c == ']')
+					json_document_error("Expected array element after \",\".");
+				return p;
+			case JSON_ARRAY_DONE:
+				json_document_error("Unexpected data after the end of the array.");
+				break;
+		}
+	}
+
+	return p;
 }
-#endif
 
 /*
- * Read one line from the source.
+ * Read the next top-level document into line_buf.
  *
- * This function uses raw_buf and line_buf, but not input_buf. raw_buf is used to
- * load the raw data from the source, and transferred data into line_buf until
- * it finds a new line character, which is the data separator of JSON Lines format.
+ * In JSONLINES_MODE_ARRAY the documents are the elements of a single array
+ * spanning the whole input, and in JSONLINES_MODE_SEQ they are concatenated
+ * documents optionally separated by whitespace or RS characters.  Documents
+ * may span any number of lines and input buffers; only the current document
+ * is kept in memory.
  *
- * XXX: support only '\n' new line.
+ * We only track string and nesting state here to find where the document
+ * ends; the document itself is validated when it's converted to jsonb.
+ *
+ * Returns true if we reached EOF without reading any document.
  */
 static bool
-JsonLineReadLine(CopyFromStateJsonLines *cstate)
+JsonDocReadNext(CopyFromStateJsonLines *cstate)
 {
-	int			nbytes;
-	bool		result = false;
+	CopyInputBuffer *buf = &cstate->input;
+	int			depth = 0;
+	bool		started = false;
+	bool		scalar = false;
+	bool		in_string = false;
+	bool		escaped = false;
 
-	resetStringInfo(&cstate->line_buf);
+	resetStringInfo(&buf->line_buf);
 
 	for (;;)
 	{
-		char		*ptr;
+		char	   *start;
+		char	   *end;
+		char	   *p;
 
 		/* Load more data if needed */
-		if (INPUT_BUF_BYTES(cstate) <= 0)
+		if (INPUT_BUF_BYTES(buf) <= 0 &&
+			!CopyInputBufferLoad((CopyFromState) cstate, buf))
 		{
-			int		inbytes;
-
-			if (cstate->compression == PG_COMPRESSION_NONE)
-			{
-				inbytes = CopyFromGetData((CopyFromState) cstate, cstate->input_buf, 1, INPUT_BUF_SIZE);
-				cstate->input_buf[inbytes] = '\0';
-				cstate->input_buf_len = inbytes;
-				cstate->input_buf_index = 0;
-				cstate->base.bytes_processed += inbytes;
-			}
-			else if (cstate->compression == PG_COMPRESSION_GZIP)
+			if (started)
 			{
-				read_gzip(cstate);
+				/* a number or literal can be terminated by EOF */
+				if (!scalar || in_string || cstate->mode == JSONLINES_MODE_ARRAY)
+					json_document_error("The input string ended unexpectedly.");
+				break;
 			}
 
-			if (INPUT_BUF_BYTES(cstate) <= 0)
+			if (cstate->mode == JSONLINES_MODE_ARRAY &&
+				cstate->array_state != JSON_ARRAY_DONE &&
+				cstate->array_state != JSON_ARRAY_BEFORE)
+				json_document_error("The input string ended unexpectedly.");
+
+			return true;
+		}
+
+		start = buf->input_buf + buf->input_buf_index;
+		end = buf->input_buf + buf->input_buf_len;
+
+		if (!started)
+		{
+			start = JsonDocSkipSeparators(cstate, start, end);
+			if (start >= end)
 			{
-				result = true;
-				break;
+				buf->input_buf_index = buf->input_buf_len;
+				continue;
 			}
-		}
 
-		ptr = strchr(cstate->input_buf + cstate->input_buf_index, '\n');
+			started = true;
+			scalar = (*start != '{' && *start != '[');
+		}
 
-		if (ptr == NULL)
+		for (p = start; p < end; p++)
 		{
-			appendBinaryStringInfo(&cstate->line_buf,
-								   cstate->input_buf + cstate->input_buf_index,
-								   cstate->input_buf_len - cstate->input_buf_index);
-			cstate->input_buf_index = cstate->input_buf_len;
-			continue;
+			char		c = *p;
+
+			if (in_string)
+			{
+				if (escaped)
+					escaped = false;
+				else if (c == '\\')
+					escaped = true;
+				else if (c == '"')
+				{
+					in_string = false;
+					if (depth == 0)
+					{
+						/* end of a top-level string */
+						p++;
+						goto done;
+					}
+				}
+				continue;
+			}
+
+			switch (c)
+			{
+				case '"':
+					in_string = true;
+					break;
+				case '{':
+				case '[':
+					depth++;
+					break;
+				case '}':
+				case ']':
+					if (depth == 0)
+						goto done;	/* e.g. ']' ending the top-level array */
+					if (--depth == 0)
+					{
+						p++;
+						goto done;
+					}
+					break;
+				case ' ':
+				case '\t':
+				case '\n':
+				case '\r':
+				case ',':
+				case '\x1e':
+					if (depth == 0)
+						goto done;	/* end of a top-level number or literal */
+					break;
+				default:
+					break;
+			}
 		}
 
-		nbytes = (ptr - cstate->input_buf) - cstate->input_buf_index;
-		appendBinaryStringInfo(&cstate->line_buf,
-							   cstate->input_buf + cstate->input_buf_index,
-							   nbytes);
-		cstate->input_buf_index += nbytes;
+		/* The document continues in the next input buffer */
+		appendBinaryStringInfo(&buf->line_buf, start, end - start);
+		buf->input_buf_index = buf->input_buf_len;
+		continue;
 
-		/* consume '\n' */
-		cstate->input_buf_index++;
+done:
+		appendBinaryStringInfo(&buf->line_buf, start, p - start);
+		buf->input_buf_index = p - buf->input_buf;
 		break;
 	}
 
-	return result;
+	if (cstate->mode == JSONLINES_MODE_ARRAY)
+		cstate->array_state = JSON_ARRAY_NEXT;
+
+	cstate->base.cur_lineno++;
+
+	return false;
 }
 
 /*
@@ -320,78 +445,369 @@ JsonLinesCopyFromInFunc(CopyFromState cstate, Oid atttypid, FmgrInfo *finfo, Oid
 	fmgr_info(func_oid, finfo);
 }
 
+/*
+ * Set up 'document_column' option.  The default expressions of the other
+ * columns are prepared here since COPY evaluates them only for the columns
+ * missing in the column list.
+ */
+static void
+JsonLinesSetupDocumentColumn(CopyFromStateJsonLines *cstate, TupleDesc tupDesc)
+{
+	Form_pg_attribute att;
+	Oid			basetype;
+	ListCell   *lc;
+
+	if (cstate->column_paths != NULL || cstate->extra_keys_column != NULL ||
+		cstate->routes != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("document_column cannot be used with column_paths, extra_keys_column or routes")));
+
+	cstate->document_attnum = CopyFindColumn(cstate->base.attnumlist, tupDesc,
+											 cstate->document_column, true);
+
+	att = TupleDescAttr(tupDesc, cstate->document_attnum - 1);
+	basetype = getBaseType(att->atttypid);
+	if (basetype != JSONOID && basetype != JSONBOID)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("document_column \"%s\" must be of type json or jsonb",
+						cstate->document_column)));
+
+	cstate->document_defexprs = palloc0(sizeof(ExprState *) * tupDesc->natts);
+
+	foreach(lc, cstate->base.attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		Expr	   *defexpr;
+
+		if (attnum == cstate->document_attnum ||
+			TupleDescAttr(tupDesc, attnum - 1)->attgenerated)
+			continue;
+
+		defexpr = (Expr *) build_column_default(cstate->base.rel, attnum);
+		if (defexpr != NULL)
+		{
+			defexpr = expression_planner(defexpr);
+			cstate->document_defexprs[attnum - 1] = ExecInitExpr(defexpr, NULL);
+		}
+	}
+}
+
+/*
+ * Return the columns to decode.  With 'convert_selectively', which
+ * jsonlines_fdw passes with the columns a query needs, the keys of the other
+ * columns are not decoded and the columns are left NULL.
+ */
+static List *
+JsonLinesDecodedColumns(CopyFromStateJsonLines *cstate)
+{
+	List	   *attnums = NIL;
+	ListCell   *lc;
+
+	if (!cstate->base.opts.convert_selectively)
+		return cstate->base.attnumlist;
+
+	foreach(lc, cstate->base.attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+
+		if (cstate->base.convert_select_flags[attnum - 1])
+			attnums = lappend_int(attnums, attnum);
+	}
+
+	return attnums;
+}
+
 static void
 JsonLinesCopyFromStart(CopyFromState ccstate, TupleDesc tupDesc)
 {
 	CopyFromStateJsonLines *cstate = (CopyFromStateJsonLines *) ccstate;
-	const char *extension = strrchr(cstate->base.filename, '.');
 
-	if (strcmp(extension, ".gz") == 0)
+	cstate->array_state = JSON_ARRAY_BEFORE;
+
+	if ((cstate->route_key == NULL) != (cstate->routes == NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("route_key and routes must be specified together")));
+
+	if (cstate->document_column != NULL)
+		JsonLinesSetupDocumentColumn(cstate, tupDesc);
+	else
+		cstate->decoder = JsonLinesCreateRowDecoder(tupDesc,
+													JsonLinesDecodedColumns(cstate),
+													cstate->base.in_functions,
+													cstate->base.typioparams,
+													cstate->column_paths,
+													cstate->extra_keys_column);
+
+	if (cstate->routes != NULL)
+	{
+		cstate->router = JsonLinesCreateRouter(cstate->route_key,
+											   cstate->routes);
+		cstate->line_cxt = AllocSetContextCreate(CurrentMemoryContext,
+												 "jsonlines line",
+												 ALLOCSET_DEFAULT_SIZES);
+	}
+
+	if (cstate->error_table != NULL)
 	{
-		cstate->compression = PG_COMPRESSION_GZIP;
-		initialize_inflate_gzip(&cstate->strm);
+		if (cstate->base.opts.on_error == COPY_ON_ERROR_STOP)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("error_table requires ON_ERROR ignore")));
 
-		cstate->raw_buf = palloc(RAW_BUF_SIZE + 1);
-		cstate->raw_buf_index = cstate->raw_buf_len = 0;
+		/* we need the error messages to record them */
+		cstate->base.escontext->details_wanted = true;
+		cstate->errtab = CopyErrorTableOpen(cstate->error_table);
 	}
-	else
-		cstate->compression = PG_COMPRESSION_NONE;
 
-	/*
-	 * Allocate buffers for the input pipeline.
-	 *
-	 * attribute_buf and raw_buf are used in both text and binary modes, but
-	 * input_buf and line_buf only in text mode.
-	 */
+	if (cstate->collect_stats || CopyStatsSharedEnabled())
+	{
+		cstate->input.stats = CopyStatsCreate();
+		cstate->input.stats->timing = !cstate->stats_no_timing;
+	}
+
+	CopyInputBufferInit((CopyFromState) cstate, &cstate->input,
+						CopyInputDetectCompression(cstate->base.filename));
+}
 
-	cstate->input_buf = palloc(INPUT_BUF_SIZE + 1);
-	cstate->input_buf_index = cstate->input_buf_len = 0;
-	cstate->input_reached_eof = false;
-	cstate->input_reached_error = false;
+static void
+JsonLinesCompactCopyFromStart(CopyFromState ccstate, TupleDesc tupDesc)
+{
+	CopyFromStateJsonLines *cstate = (CopyFromStateJsonLines *) ccstate;
 
-	initStringInfo(&cstate->line_buf);
-	cstate->base.line_buf = &cstate->line_buf;
+	if (cstate->mode != JSONLINES_MODE_LINES)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("jsonlines_compact format supports only \"lines\" mode")));
+	if (cstate->column_paths != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("column_paths is not supported in jsonlines_compact format")));
+	if (cstate->extra_keys_column != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("extra_keys_column is not supported in jsonlines_compact format")));
+	if (cstate->routes != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("routes is not supported in jsonlines_compact format")));
+	if (cstate->document_column != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("document_column is not supported in jsonlines_compact format")));
+
+	cstate->compact = true;
+	cstate->header_read = false;
+
+	JsonLinesCopyFromStart(ccstate, tupDesc);
 }
 
 /*
- * Write a C-string representation of the given JsonbValue to 'str'.
+ * Read the header line of jsonlines_compact format in line_buf, and set up
+ * the mapping from the positions of the row arrays to the columns.
+ *
+ * The header is an object with a "columns" array whose elements are either
+ * objects with a "name" key, as written by COPY TO, or plain column names.
+ * Positions whose name doesn't match any of the target columns are skipped.
  */
 static void
-GetJsonbValueAsCString(JsonbValue *v, StringInfo str)
+JsonLinesReadCompactHeader(CopyFromStateJsonLines *cstate, TupleDesc tupdesc)
 {
-	switch (v->type)
+	Jsonb	   *jb;
+	JsonbValue	vbuf;
+	JsonbValue *columns;
+	JsonbContainer *container;
+	CopyKeyMap *map;
+	bool	   *seen;
+
+	jb = DatumGetJsonbP(DirectFunctionCall1(jsonb_in,
+											CStringGetDatum(cstate->input.line_buf.data)));
+
+	columns = JB_ROOT_IS_OBJECT(jb) ?
+		getKeyJsonValueFromContainer(&jb->root, "columns", 7, &vbuf) : NULL;
+
+	if (columns == NULL || columns->type != jbvBinary ||
+		!JsonContainerIsArray(columns->val.binary.data))
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("invalid jsonlines_compact header"),
+				 errdetail("The first line must be an object with a \"columns\" array.")));
+
+	container = columns->val.binary.data;
+	map = CopyKeyMapFromColumns(tupdesc, cstate->base.attnumlist, NIL);
+	seen = palloc0(sizeof(bool) * tupdesc->natts);
+
+	cstate->header_ncolumns = JsonContainerSize(container);
+	cstate->header_attnums = palloc0(sizeof(int) * Max(cstate->header_ncolumns, 1));
+
+	for (int i = 0; i < cstate->header_ncolumns; i++)
 	{
-		case jbvNull:
-			/* must be handled by the caller */
-			break;
+		JsonbValue *elem = getIthJsonbValueFromContainer(container, i);
+		JsonbValue *name = elem;
+		JsonbValue	namebuf;
+		int			attnum;
 
-		case jbvBool:
-			appendStringInfoString(str, v->val.boolean ? "true" : "false");
-			break;
+		if (elem->type == jbvBinary && JsonContainerIsObject(elem->val.binary.data))
+			name = getKeyJsonValueFromContainer(elem->val.binary.data,
+												"name", 4, &namebuf);
 
-		case jbvString:
-			appendBinaryStringInfo(str, v->val.string.val, v->val.string.len);
-			break;
-		case jbvNumeric:
-			{
-				Datum		cstr;
+		if (name == NULL || name->type != jbvString)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid jsonlines_compact header"),
+					 errdetail("Element %d of \"columns\" has no column name.", i + 1)));
+
+		attnum = CopyKeyMapLookup(map, name->val.string.val, name->val.string.len);
+		if (attnum == 0)
+			continue;
 
-				cstr = DirectFunctionCall1(numeric_out,
-										   PointerGetDatum(v->val.numeric));
+		if (seen[attnum - 1])
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("column \"%s\" appears more than once in jsonlines_compact header",
+							NameStr(TupleDescAttr(tupdesc, attnum - 1)->attname))));
 
-				appendStringInfoString(str, DatumGetCString(cstr));
-				break;
-			}
+		seen[attnum - 1] = true;
+		cstate->header_attnums[i] = attnum;
+	}
 
-		case jbvBinary:
-			(void) JsonbToCString(str, v->val.binary.data, v->val.binary.len);
-			break;
+	pfree(seen);
+	cstate->header_read = true;
+}
+
+/*
+ * Fill the columns from a jsonlines_compact row, a JSON array holding the
+ * values in the order of the header.  Missing trailing values are NULL.
+ *
+ * Returns false on a soft error, like JsonLinesDecodeRow().
+ */
+static bool
+JsonLinesFillCompactRow(CopyFromStateJsonLines *cstate, Jsonb *jb,
+						Datum *values, bool *nulls)
+{
+	Node	   *escontext = (Node *) cstate->base.escontext;
+	ListCell   *lc;
+	int			n;
+
+	cstate->decoder->error_attnum = 0;
+
+	if (!JB_ROOT_IS_ARRAY(jb) || JB_ROOT_IS_SCALAR(jb))
+		ereturn(escontext, false,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("jsonlines_compact row must be a JSON array")));
+
+	n = JB_ROOT_COUNT(jb);
+	if (n > cstate->header_ncolumns)
+		ereturn(escontext, false,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("extra data after last expected column")));
+
+	foreach(lc, cstate->base.attnumlist)
+		nulls[lfirst_int(lc) - 1] = true;
+
+	for (int i = 0; i < n; i++)
+	{
+		int			attnum = cstate->header_attnums[i];
+
+		if (attnum == 0)
+			continue;
+
+		if (!JsonLinesDecodeValue(cstate->decoder, attnum,
+								  getIthJsonbValueFromContainer(&jb->root, i),
+								  values, nulls, escontext))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read the next document into line_buf.  Returns true at EOF.
+ */
+static bool
+JsonLinesReadNextDocument(CopyFromStateJsonLines *cstate)
+{
+	if (cstate->mode == JSONLINES_MODE_LINES)
+		return CopyInputBufferReadLine((CopyFromState) cstate, &cstate->input);
+
+	return JsonDocReadNext(cstate);
+}
 
-		default:
-			elog(ERROR, "unrecognized jsonb type: %d", (int) v->type);
+/*
+ * Store the document in line_buf into the document column as a whole, and
+ * fill the other columns with their default values.  Returns false on a soft
+ * error.
+ */
+static bool
+JsonLinesFillDocumentRow(CopyFromStateJsonLines *cstate, ExprContext *econtext,
+						 Datum *values, bool *nulls)
+{
+	int			m = cstate->document_attnum - 1;
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(cstate->base.rel), m);
+	ListCell   *lc;
+
+	foreach(lc, cstate->base.attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		ExprState  *defexpr = cstate->document_defexprs[attnum - 1];
+
+		if (defexpr != NULL)
+			values[attnum - 1] = ExecEvalExpr(defexpr, econtext,
+											  &nulls[attnum - 1]);
+		else
+			nulls[attnum - 1] = true;
 	}
 
-	return;
+	/* Only the input function of the column looks at the document */
+	nulls[m] = false;
+
+	return InputFunctionCallSafe(&cstate->base.in_functions[m],
+								 cstate->input.line_buf.data,
+								 cstate->base.typioparams[m],
+								 att->atttypmod,
+								 (Node *) cstate->base.escontext,
+								 &values[m]);
+}
+
+/*
+ * Skip the current row after a soft error.  The error is counted so that
+ * COPY can enforce REJECT_LIMIT, and recorded in the error table if any.
+ * 'attnum' is the column that failed to convert, or 0.
+ */
+static void
+JsonLinesSkipRow(CopyFromStateJsonLines *cstate, int attnum)
+{
+	ErrorSaveContext *escontext = cstate->base.escontext;
+	char	   *attname = NULL;
+
+	Assert(escontext != NULL && escontext->error_occurred);
+
+	cstate->base.num_errors++;
+
+	if (attnum != 0)
+		attname = NameStr(TupleDescAttr(RelationGetDescr(cstate->base.rel),
+										attnum - 1)->attname);
+
+	TRACE_COPY_CONVERSION_FAILURE(cstate->base.cur_lineno, attname);
+
+	if (cstate->base.opts.log_verbosity == COPY_LOG_VERBOSITY_VERBOSE)
+	{
+		if (attname != NULL)
+			ereport(NOTICE,
+					errmsg("skipping row due to data type incompatibility at line %" PRIu64 " for column \"%s\"",
+						   cstate->base.cur_lineno, attname));
+		else
+			ereport(NOTICE,
+					errmsg("skipping row due to invalid data at line %" PRIu64,
+						   cstate->base.cur_lineno));
+	}
+
+	if (cstate->errtab != NULL)
+		CopyErrorTableAdd(cstate->errtab, cstate->base.cur_lineno, attname,
+						  escontext->error_data->message,
+						  cstate->input.line_buf.data);
 }
 
 static bool
@@ -400,73 +816,105 @@ JsonLinesCopyFromOneRow(CopyFromState ccstate, ExprContext *econtext, Datum *val
 {
 	CopyFromStateJsonLines *cstate = (CopyFromStateJsonLines *) ccstate;
 	TupleDesc tupdesc = RelationGetDescr(cstate->base.rel);
-	Jsonb	*jb;
+	Jsonb	*jb = NULL;
 	Datum	jsonb_data;
-	ListCell	*lc;
-	StringInfoData buf;
 	bool	ret;
+	CopyStats  *stats = cstate->input.stats;
 
-	if (JsonLineReadLine(cstate))
-		return false;
+	CopyStatsBeginRow(stats);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_SPLIT);
 
-	/* Convert the raw input line to a jsonb value */
-	ret = DirectInputFunctionCallSafe(jsonb_in, cstate->line_buf.data,
-									  JSONBOID, -1,
-									  (Node *) cstate->base.escontext,
-									  &jsonb_data);
-
-	if (!ret)
-		elog(ERROR, "invalid data for jsonb value");
+	/* The first line of jsonlines_compact data is the header */
+	if (cstate->compact && !cstate->header_read)
+	{
+		if (CopyInputBufferReadLine((CopyFromState) cstate, &cstate->input))
+			return false;
 
-	jb = DatumGetJsonbP(jsonb_data);
+		JsonLinesReadCompactHeader(cstate, tupdesc);
+	}
 
-	initStringInfo(&buf);
-	foreach(lc, cstate->base.attnumlist)
+	/*
+	 * On a soft error, the row is skipped and COPY sees the error in
+	 * escontext.
+	 */
+	if (cstate->document_attnum != 0)
+	{
+		if (JsonLinesReadNextDocument(cstate))
+			return false;
+		CopyStatsAddBytes(stats, COPY_PHASE_SPLIT, cstate->input.line_buf.len);
+		TRACE_COPY_ROW_PARSE_START(cstate->base.cur_lineno);
+
+		(void) CopyStatsSwitch(stats, COPY_PHASE_PARSE);
+		if (!JsonLinesFillDocumentRow(cstate, econtext, values, nulls))
+			JsonLinesSkipRow(cstate, cstate->document_attnum);
+	}
+	else
 	{
-		int	attnum = lfirst_int(lc);
-		JsonbValue	*v;
-		JsonbValue vbuf;
-		Form_pg_attribute att = TupleDescAttr(tupdesc, attnum - 1);
-		char	*attname = NameStr(att->attname);
+		for (;;)
+		{
+			MemoryContext oldcxt = CurrentMemoryContext;
 
-		/* The jsonb value for the key with the column name */
-		v = getKeyJsonValueFromContainer(&jb->root,
-										 attname, strlen(attname), &vbuf);
+			(void) CopyStatsSwitch(stats, COPY_PHASE_SPLIT);
+			if (JsonLinesReadNextDocument(cstate))
+				return false;
+			CopyStatsAddBytes(stats, COPY_PHASE_SPLIT, cstate->input.line_buf.len);
+			TRACE_COPY_ROW_PARSE_START(cstate->base.cur_lineno);
 
-		/*
-		 * Fill with NULL if either not found or the value represent NULL.
-		 */
-		if (v == NULL || v->type == jbvNull)
-		{
-			nulls[attnum - 1] = true;
-			continue;
-		}
+			/* Documents sent to other tables must not pile up in our context */
+			if (cstate->router != NULL)
+			{
+				MemoryContextReset(cstate->line_cxt);
+				MemoryContextSwitchTo(cstate->line_cxt);
+			}
 
-		nulls[attnum - 1] = false;
+			/* Convert the raw input line to a jsonb value */
+			(void) CopyStatsSwitch(stats, COPY_PHASE_PARSE);
+			ret = DirectInputFunctionCallSafe(jsonb_in, cstate->input.line_buf.data,
+											  JSONBOID, -1,
+											  (Node *) cstate->base.escontext,
+											  &jsonb_data);
 
-		/* Convert the jsonb value to cstring */
-		GetJsonbValueAsCString(v, &buf);
+			MemoryContextSwitchTo(oldcxt);
 
-		/* Convert the cstring data into the column */
-		ret = InputFunctionCallSafe(&(cstate->base.in_functions[attnum - 1]),
-									buf.data,
-									cstate->base.typioparams[attnum - 1],
-									att->atttypmod,
-									(Node *) cstate->base.escontext,
-									&values[attnum - 1]);
+			if (!ret)
+				break;
 
-		if (!ret)
-			elog(ERROR, "could not convert jsonb value \"%s\" to data for column \"%s\"",
-				 buf.data, attname);
+			jb = DatumGetJsonbP(jsonb_data);
+
+			(void) CopyStatsSwitch(stats, COPY_PHASE_CONVERT);
+			if (cstate->router == NULL || !JsonLinesRouteRow(cstate->router, jb))
+				break;
+
+			TRACE_COPY_ROW_PARSE_DONE(cstate->base.cur_lineno, false);
+		}
 
-		resetStringInfo(&buf);
+		if (!ret)
+			JsonLinesSkipRow(cstate, 0);
+		else if (cstate->compact ?
+				 !JsonLinesFillCompactRow(cstate, jb, values, nulls) :
+				 !JsonLinesDecodeRow(cstate->decoder, jb, values, nulls,
+									 (Node *) cstate->base.escontext))
+			JsonLinesSkipRow(cstate, cstate->decoder->error_attnum);
 	}
 
+	TRACE_COPY_ROW_PARSE_DONE(cstate->base.cur_lineno,
+							  cstate->base.escontext != NULL &&
+							  cstate->base.escontext->error_occurred);
+
 	/* Set output parameters */
 	if (rowinfo)
 	{
 		rowinfo->lineno = cstate->base.cur_lineno;
-		rowinfo->tuplen = cstate->line_buf.len;
+		rowinfo->tuplen = cstate->input.line_buf.len;
+	}
+
+	if (stats != NULL)
+	{
+		/* skipped rows are counted as errors at the end */
+		if (cstate->base.escontext == NULL ||
+			!cstate->base.escontext->error_occurred)
+			stats->rows++;
+		(void) CopyStatsSwitch(stats, COPY_PHASE_OTHER);
 	}
 
 	return true;
@@ -476,9 +924,31 @@ static void
 JsonLinesCopyFromEnd(CopyFromState ccstate)
 {
 	CopyFromStateJsonLines *cstate = (CopyFromStateJsonLines *) ccstate;
+	CopyStats  *stats = cstate->input.stats;
+
+	if (stats != NULL)
+		CopyStatsEndRows(stats);
 
-	if (cstate->compression == PG_COMPRESSION_GZIP)
-		end_inflate_gzip(cstate);
+	if (cstate->router != NULL)
+	{
+		uint64		routed = JsonLinesFinishRouter(cstate->router);
+
+		if (stats != NULL)
+			stats->rows += routed;
+	}
+
+	if (cstate->errtab != NULL)
+		CopyErrorTableClose(cstate->errtab);
+
+	CopyInputBufferEnd(&cstate->input);
+
+	if (stats != NULL)
+	{
+		stats->errors = cstate->base.num_errors;
+		CopyStatsFinish(stats,
+						cstate->compact ? "jsonlines_compact" : "jsonlines",
+						true, cstate->collect_stats);
+	}
 }
 
 static void
@@ -487,6 +957,67 @@ JsonLinesCopyToOutFunc(CopyToState cstate, Oid atttypid, FmgrInfo *finfo)
 	/* Nothing to do */
 }
 
+/*
+ * Send one line of output, compressing it if requested.
+ */
+static void
+JsonLinesWriteLine(CopyToStateJsonLines *cstate, const char *data, int len)
+{
+	if (cstate->options.compression == PG_COMPRESSION_NONE)
+	{
+		appendBinaryStringInfo(cstate->base.fe_msgbuf, data, len);
+		appendStringInfoCharMacro(cstate->base.fe_msgbuf, '\n');
+		/* End of row */
+		(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_WRITE);
+		CopyStatsAddBytes(cstate->stats, COPY_PHASE_WRITE, len + 1);
+		TRACE_COPY_FLUSH(len + 1);
+		CopyToFlushData((CopyToState) cstate);
+	}
+#ifdef HAVE_LIBZ
+	else if (cstate->options.compression == PG_COMPRESSION_GZIP)
+	{
+		resetStringInfo(&cstate->inbuf);
+		appendBinaryStringInfo(&cstate->inbuf, data, len);
+		appendStringInfoCharMacro(&cstate->inbuf, '\n');
+		write_gzip(cstate, cstate->inbuf.data, Z_NO_FLUSH);
+	}
+#endif
+}
+
+/*
+ * Write the header line of jsonlines_compact format, listing the name and
+ * type of each column in the order of the row arrays.
+ */
+static void
+JsonLinesWriteCompactHeader(CopyToStateJsonLines *cstate, TupleDesc tupDesc)
+{
+	StringInfoData buf;
+	ListCell   *lc;
+
+	initStringInfo(&buf);
+	appendStringInfoString(&buf, "{\"columns\":[");
+
+	foreach(lc, cstate->base.attnumlist)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, lfirst_int(lc) - 1);
+
+		if (foreach_current_index(lc) > 0)
+			appendStringInfoChar(&buf, ',');
+
+		appendStringInfoString(&buf, "{\"name\":");
+		escape_json(&buf, NameStr(att->attname));
+		appendStringInfoString(&buf, ",\"type\":");
+		escape_json(&buf, format_type_with_typemod(att->atttypid,
+													att->atttypmod));
+		appendStringInfoChar(&buf, '}');
+	}
+
+	appendStringInfoString(&buf, "]}");
+
+	JsonLinesWriteLine(cstate, buf.data, buf.len);
+	pfree(buf.data);
+}
+
 static void
 JsonLinesCopyToStart(CopyToState ccstate, TupleDesc tupDesc)
 {
@@ -519,44 +1050,80 @@ JsonLinesCopyToStart(CopyToState ccstate, TupleDesc tupDesc)
 		case PG_COMPRESSION_ZSTD:
 			break;
 	}
+
+	if (cstate->options.stats || CopyStatsSharedEnabled())
+	{
+		cstate->stats = CopyStatsCreate();
+		cstate->stats->timing = !cstate->options.stats_no_timing;
+	}
+
+	if (cstate->compact && cstate->options.omit_nulls)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("omit_nulls is not supported in jsonlines_compact format")));
+
+	cstate->encoder = JsonLinesCreateRowEncoder(tupDesc,
+												cstate->base.attnumlist);
+	cstate->encoder->omit_nulls = cstate->options.omit_nulls;
+	initStringInfo(&cstate->rowbuf);
+
+	if (cstate->compact)
+		JsonLinesWriteCompactHeader(cstate, tupDesc);
+}
+
+static void
+JsonLinesCompactCopyToStart(CopyToState ccstate, TupleDesc tupDesc)
+{
+	CopyToStateJsonLines *cstate = (CopyToStateJsonLines *) ccstate;
+
+	cstate->compact = true;
+
+	JsonLinesCopyToStart(ccstate, tupDesc);
 }
 
 static void
 JsonLinesCopyToOneRow(CopyToState ccstate, TupleTableSlot *slot)
 {
 	CopyToStateJsonLines *cstate = (CopyToStateJsonLines *) ccstate;
-	Datum	json_text;
-	char	*str;
 
-	/*
-	 * Convert the whole row to json value using row_to_json() function.
-	 */
-	json_text = DirectFunctionCall1(row_to_json, ExecFetchSlotHeapTupleDatum(slot));
+	CopyStatsBeginRow(cstate->stats);
+	(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_ENCODE);
 
-	str = text_to_cstring(DatumGetTextP(json_text));
+	slot_getallattrs(slot);
 
-	if (cstate->options.compression == PG_COMPRESSION_NONE)
-	{
-		appendBinaryStringInfo(cstate->base.fe_msgbuf, str, strlen(str));
-		appendStringInfoCharMacro(cstate->base.fe_msgbuf, '\n');
-		/* End of row */
-		CopyToFlushData((CopyToState) cstate);
-	}
-	else if (cstate->options.compression == PG_COMPRESSION_GZIP)
+	resetStringInfo(&cstate->rowbuf);
+
+	if (cstate->compact)
+		JsonLinesEncodeRowArray(cstate->encoder, slot->tts_values,
+								slot->tts_isnull, &cstate->rowbuf);
+	else
+		JsonLinesEncodeRow(cstate->encoder, slot->tts_values,
+						   slot->tts_isnull, &cstate->rowbuf);
+
+	JsonLinesWriteLine(cstate, cstate->rowbuf.data, cstate->rowbuf.len);
+
+	if (cstate->stats != NULL)
 	{
-		resetStringInfo(&cstate->inbuf);
-		appendStringInfoString(&cstate->inbuf, str);
-		appendStringInfoCharMacro(&cstate->inbuf, '\n');
-		write_gzip(cstate, cstate->inbuf.data, Z_NO_FLUSH);
+		cstate->stats->rows++;
+		(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_OTHER);
 	}
 }
+
 static void
 JsonLinesCopyToEnd(CopyToState ccstate)
 {
 	CopyToStateJsonLines *cstate = (CopyToStateJsonLines *) ccstate;
 
+	if (cstate->stats != NULL)
+		CopyStatsEndRows(cstate->stats);
+
 	if (cstate->options.compression == PG_COMPRESSION_GZIP)
 		end_deflate_gzip(cstate);
+
+	if (cstate->stats != NULL)
+		CopyStatsFinish(cstate->stats,
+						cstate->compact ? "jsonlines_compact" : "jsonlines",
+						false, cstate->options.stats);
 }
 
 static Size
@@ -602,16 +1169,102 @@ JsonLinesCopyToProcessOneOption(CopyToState ccstate, DefElem *option)
 
 		return true;
 	}
+	else if (strcmp(option->defname, "omit_nulls") == 0)
+	{
+		cstate->options.omit_nulls = defGetBoolean(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "stats") == 0)
+	{
+		cstate->options.stats = defGetBoolean(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "stats_timing") == 0)
+	{
+		cstate->options.stats_no_timing = !defGetBoolean(option);
+
+		return true;
+	}
 
 	return false;
 }
 
-/*
 static bool
 JsonLinesCopyFromProcessOneOption(CopyFromState ccstate, DefElem *option)
 {
+	CopyFromStateJsonLines *cstate = (CopyFromStateJsonLines *) ccstate;
+
+	if (strcmp(option->defname, "mode") == 0)
+	{
+		char	   *optval = defGetString(option);
+
+		if (strcmp(optval, "lines") == 0)
+			cstate->mode = JSONLINES_MODE_LINES;
+		else if (strcmp(optval, "array") == 0)
+			cstate->mode = JSONLINES_MODE_ARRAY;
+		else if (strcmp(optval, "seq") == 0)
+			cstate->mode = JSONLINES_MODE_SEQ;
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("unrecognized jsonlines mode: \"%s\"", optval),
+					 errhint("Valid modes are \"lines\", \"array\" and \"seq\".")));
+
+		return true;
+	}
+	else if (strcmp(option->defname, "column_paths") == 0)
+	{
+		cstate->column_paths = defGetString(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "extra_keys_column") == 0)
+	{
+		cstate->extra_keys_column = defGetString(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "stats") == 0)
+	{
+		cstate->collect_stats = defGetBoolean(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "stats_timing") == 0)
+	{
+		cstate->stats_no_timing = !defGetBoolean(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "error_table") == 0)
+	{
+		cstate->error_table = defGetString(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "document_column") == 0)
+	{
+		cstate->document_column = defGetString(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "route_key") == 0)
+	{
+		cstate->route_key = defGetString(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "routes") == 0)
+	{
+		cstate->routes = defGetString(option);
+
+		return true;
+	}
+
+	return false;
 }
-*/
 
 
 static const CopyToRoutine JsonLinesCopyToRoutine = {
@@ -625,19 +1278,39 @@ static const CopyToRoutine JsonLinesCopyToRoutine = {
 
 static const CopyFromRoutine JsonLinesCopyFromRoutine = {
 	.CopyFromEstimateStateSpace = JsonLinesCopyFromEsimateSpace,
-	//.CopyFromProcessOneOption = JsonLinesCopyFromProcessOneOption,
-	.CopyFromProcessOneOption = NULL,
+	.CopyFromProcessOneOption = JsonLinesCopyFromProcessOneOption,
 	.CopyFromInFunc = JsonLinesCopyFromInFunc,
 	.CopyFromStart = JsonLinesCopyFromStart,
 	.CopyFromOneRow = JsonLinesCopyFromOneRow,
 	.CopyFromEnd = JsonLinesCopyFromEnd,
 };
 
+static const CopyToRoutine JsonLinesCompactCopyToRoutine = {
+	.CopyToEstimateStateSpace = JsonLinesCopyToEsimateSpace,
+	.CopyToProcessOneOption = JsonLinesCopyToProcessOneOption,
+	.CopyToOutFunc = JsonLinesCopyToOutFunc,
+	.CopyToStart = JsonLinesCompactCopyToStart,
+	.CopyToOneRow = JsonLinesCopyToOneRow,
+	.CopyToEnd = JsonLinesCopyToEnd,
+};
+
+static const CopyFromRoutine JsonLinesCompactCopyFromRoutine = {
+	.CopyFromEstimateStateSpace = JsonLinesCopyFromEsimateSpace,
+	.CopyFromProcessOneOption = JsonLinesCopyFromProcessOneOption,
+	.CopyFromInFunc = JsonLinesCopyFromInFunc,
+	.CopyFromStart = JsonLinesCompactCopyFromStart,
+	.CopyFromOneRow = JsonLinesCopyFromOneRow,
+	.CopyFromEnd = JsonLinesCopyFromEnd,
+};
+
 void
 RegisterJsonLinesCopyFormat(void)
 {
 	RegisterCopyCustomFormat("jsonlines",
 							 &JsonLinesCopyFromRoutine,
 							 &JsonLinesCopyToRoutine);
+	RegisterCopyCustomFormat("jsonlines_compact",
+							 &JsonLinesCompactCopyFromRoutine,
+							 &JsonLinesCompactCopyToRoutine);
 }
 
@@ -0,0 +1,455 @@
+/*--------------------------------------------------------------------------
+ *
+ * jsonlines_decoding.c
+ *		Logical decoding output plugin emitting JSON Lines.
+ *
+ * Each change is written as one JSON object on its own line, e.g.
+ *
+ *	{"op":"update","xid":750,"lsn":"0/1A2B3C8","schema":"public",
+ *	 "table":"t","new":{"id":1,"name":"b"},"old":{"id":1}}
+ *
+ * The rows are encoded by the row encoder of the jsonlines format.  The
+ * encoders are cached per relation and rebuilt when the relation is
+ * invalidated or rewritten.
+ *
+ * The records of a transaction are collected in a buffer and written out at
+ * commit, so a transaction is normally written as a single message.  Large
+ * transactions are written in batches of 'batch-size' bytes.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		jsonlines_decoding.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_class.h"
+#include "commands/defrem.h"
+#include "replication/logical.h"
+#include "replication/output_plugin.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/json.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "varatt.h"
+
+#include "pg_custom_copy_formats.h"
+
+/* Default of the 'batch-size' option */
+#define JSONLINES_DECODING_BATCH_SIZE	(1024 * 1024)
+
+typedef struct JsonLinesDecodingData
+{
+	MemoryContext context;		/* reset after each change */
+	MemoryContext cachecxt;		/* relation cache */
+	bool		include_xids;
+	bool		include_lsn;
+	int			batch_size;
+	StringInfoData buf;			/* records of the current transaction */
+} JsonLinesDecodingData;
+
+/*
+ * Per-relation cache entry.
+ */
+typedef struct JsonLinesRelEntry
+{
+	Oid			relid;			/* hash key */
+	bool		valid;
+	RelFileNumber relfilenumber;
+	MemoryContext context;		/* holds the fields below */
+	char	   *table;			/* "schema":"...","table":"..." */
+	JsonLinesRowEncoder *encoder;
+} JsonLinesRelEntry;
+
+static HTAB *RelEntryCache = NULL;
+static bool relcache_callback_registered = false;
+
+static void jsonlines_decode_startup(LogicalDecodingContext *ctx,
+									 OutputPluginOptions *opt, bool is_init);
+static void jsonlines_decode_shutdown(LogicalDecodingContext *ctx);
+static void jsonlines_decode_begin_txn(LogicalDecodingContext *ctx,
+									   ReorderBufferTXN *txn);
+static void jsonlines_decode_commit_txn(LogicalDecodingContext *ctx,
+										ReorderBufferTXN *txn,
+										XLogRecPtr commit_lsn);
+static void jsonlines_decode_change(LogicalDecodingContext *ctx,
+									ReorderBufferTXN *txn, Relation relation,
+									ReorderBufferChange *change);
+static void jsonlines_decode_truncate(LogicalDecodingContext *ctx,
+									  ReorderBufferTXN *txn, int nrelations,
+									  Relation relations[],
+									  ReorderBufferChange *change);
+
+/*
+ * Output plugin entry point, looked up when the library is used as the
+ * plugin of a replication slot.
+ */
+void
+_PG_output_plugin_init(OutputPluginCallbacks *cb)
+{
+	cb->startup_cb = jsonlines_decode_startup;
+	cb->begin_cb = jsonlines_decode_begin_txn;
+	cb->change_cb = jsonlines_decode_change;
+	cb->truncate_cb = jsonlines_decode_truncate;
+	cb->commit_cb = jsonlines_decode_commit_txn;
+	cb->shutdown_cb = jsonlines_decode_shutdown;
+}
+
+/*
+ * Relcache invalidation callback, marking the cached entries to be rebuilt.
+ */
+static void
+jsonlines_decode_relcache_callback(Datum arg, Oid relid)
+{
+	HASH_SEQ_STATUS status;
+	JsonLinesRelEntry *entry;
+
+	if (RelEntryCache == NULL)
+		return;
+
+	if (OidIsValid(relid))
+	{
+		entry = hash_search(RelEntryCache, &relid, HASH_FIND, NULL);
+		if (entry != NULL)
+			entry->valid = false;
+		return;
+	}
+
+	hash_seq_init(&status, RelEntryCache);
+	while ((entry = hash_seq_search(&status)) != NULL)
+		entry->valid = false;
+}
+
+static void
+jsonlines_decode_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt,
+						 bool is_init)
+{
+	JsonLinesDecodingData *data;
+	HASHCTL		hash_ctl;
+	ListCell   *option;
+
+	data = palloc0(sizeof(JsonLinesDecodingData));
+	data->context = AllocSetContextCreate(ctx->context,
+										  "jsonlines decoding context",
+										  ALLOCSET_DEFAULT_SIZES);
+	data->cachecxt = AllocSetContextCreate(ctx->context,
+										   "jsonlines decoding relation cache",
+										   ALLOCSET_DEFAULT_SIZES);
+	data->include_xids = true;
+	data->include_lsn = true;
+	data->batch_size = JSONLINES_DECODING_BATCH_SIZE;
+	initStringInfo(&data->buf);
+
+	ctx->output_plugin_private = data;
+	opt->output_type = OUTPUT_PLUGIN_TEXTUAL_OUTPUT;
+	opt->receive_rewrites = false;
+
+	foreach(option, ctx->output_plugin_options)
+	{
+		DefElem    *elem = lfirst(option);
+
+		if (strcmp(elem->defname, "include-xids") == 0)
+		{
+			/* if option does not provide a value, it means its value is true */
+			if (elem->arg == NULL)
+				data->include_xids = true;
+			else
+				data->include_xids = defGetBoolean(elem);
+		}
+		else if (strcmp(elem->defname, "include-lsn") == 0)
+		{
+			if (elem->arg == NULL)
+				data->include_lsn = true;
+			else
+				data->include_lsn = defGetBoolean(elem);
+		}
+		else if (strcmp(elem->defname, "batch-size") == 0)
+		{
+			if (elem->arg == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("batch-size requires a value")));
+
+			data->batch_size = pg_strtoint32(strVal(elem->arg));
+			if (data->batch_size <= 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("batch-size must be a positive integer")));
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("option \"%s\" = \"%s\" is unknown",
+							elem->defname,
+							elem->arg ? strVal(elem->arg) : "(null)")));
+	}
+
+	hash_ctl.keysize = sizeof(Oid);
+	hash_ctl.entrysize = sizeof(JsonLinesRelEntry);
+	hash_ctl.hcxt = data->cachecxt;
+	RelEntryCache = hash_create("jsonlines decoding relation cache", 128,
+								&hash_ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	if (!relcache_callback_registered)
+	{
+		CacheRegisterRelcacheCallback(jsonlines_decode_relcache_callback,
+									  (Datum) 0);
+		relcache_callback_registered = true;
+	}
+}
+
+static void
+jsonlines_decode_shutdown(LogicalDecodingContext *ctx)
+{
+	JsonLinesDecodingData *data = ctx->output_plugin_private;
+
+	/* the cache lives in data->cachecxt */
+	RelEntryCache = NULL;
+
+	MemoryContextDelete(data->context);
+	MemoryContextDelete(data->cachecxt);
+}
+
+/*
+ * Return the cache entry of the relation, (re)building it if needed.
+ */
+static JsonLinesRelEntry *
+get_rel_entry(JsonLinesDecodingData *data, Relation relation)
+{
+	Oid			relid = RelationGetRelid(relation);
+	JsonLinesRelEntry *entry;
+	bool		found;
+	MemoryContext oldcxt;
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	List	   *attnumlist = NIL;
+	StringInfoData buf;
+
+	entry = hash_search(RelEntryCache, &relid, HASH_ENTER, &found);
+
+	if (found && entry->valid &&
+		entry->relfilenumber == relation->rd_locator.relNumber)
+		return entry;
+
+	if (found)
+		MemoryContextDelete(entry->context);
+
+	entry->context = AllocSetContextCreate(data->cachecxt,
+										   "jsonlines decoding relation",
+										   ALLOCSET_SMALL_SIZES);
+	oldcxt = MemoryContextSwitchTo(entry->context);
+
+	initStringInfo(&buf);
+	appendStringInfoString(&buf, "\"schema\":");
+	escape_json(&buf, get_namespace_name(RelationGetNamespace(relation)));
+	appendStringInfoString(&buf, ",\"table\":");
+	escape_json(&buf, RelationGetRelationName(relation));
+	entry->table = buf.data;
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (att->attisdropped || att->attgenerated)
+			continue;
+		attnumlist = lappend_int(attnumlist, i + 1);
+	}
+	entry->encoder = JsonLinesCreateRowEncoder(tupdesc, attnumlist);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	entry->relfilenumber = relation->rd_locator.relNumber;
+	entry->valid = true;
+
+	return entry;
+}
+
+/*
+ * Append the tuple as a JSON object.  Unchanged TOASTed values are not in
+ * the WAL, so their keys are left out, and so are NULLs if skip_nulls is
+ * set.
+ */
+static void
+append_tuple(StringInfo buf, JsonLinesRowEncoder *enc, TupleDesc tupdesc,
+			 HeapTuple tuple, bool skip_nulls)
+{
+	Datum	   *values = palloc(sizeof(Datum) * tupdesc->natts);
+	bool	   *nulls = palloc(sizeof(bool) * tupdesc->natts);
+	bool		first = true;
+
+	heap_deform_tuple(tuple, tupdesc, values, nulls);
+
+	appendStringInfoChar(buf, '{');
+
+	for (int i = 0; i < enc->ncolumns; i++)
+	{
+		JsonLinesColumnEncoder *col = &enc->columns[i];
+		int			m = col->attnum - 1;
+
+		if (nulls[m] && skip_nulls)
+			continue;
+
+		if (!nulls[m] && TupleDescAttr(tupdesc, m)->attlen == -1 &&
+			VARATT_IS_EXTERNAL_ONDISK(DatumGetPointer(values[m])))
+			continue;
+
+		if (!first)
+			appendStringInfoChar(buf, ',');
+		first = false;
+
+		appendBinaryStringInfo(buf, col->key, col->keylen);
+
+		if (nulls[m])
+			appendBinaryStringInfo(buf, "null", 4);
+		else
+			JsonLinesEncodeDatum(col, values[m], buf);
+	}
+
+	appendStringInfoChar(buf, '}');
+}
+
+/*
+ * Start a record, appending the fields common to all the operations.
+ */
+static void
+begin_record(JsonLinesDecodingData *data, ReorderBufferTXN *txn,
+			 XLogRecPtr lsn, const char *op, JsonLinesRelEntry *entry)
+{
+	StringInfo	buf = &data->buf;
+
+	appendStringInfo(buf, "{\"op\":\"%s\"", op);
+	if (data->include_xids)
+		appendStringInfo(buf, ",\"xid\":%u", txn->xid);
+	if (data->include_lsn)
+		appendStringInfo(buf, ",\"lsn\":\"%X/%X\"", LSN_FORMAT_ARGS(lsn));
+	appendStringInfoChar(buf, ',');
+	appendStringInfoString(buf, entry->table);
+}
+
+/*
+ * Write out the buffered records.
+ */
+static void
+flush_records(LogicalDecodingContext *ctx, bool last_write)
+{
+	JsonLinesDecodingData *data = ctx->output_plugin_private;
+
+	if (data->buf.len == 0)
+		return;
+
+	OutputPluginPrepareWrite(ctx, last_write);
+	appendBinaryStringInfo(ctx->out, data->buf.data, data->buf.len);
+	OutputPluginWrite(ctx, last_write);
+
+	resetStringInfo(&data->buf);
+}
+
+/*
+ * End a record, and write out the batch if it's full.
+ */
+static void
+end_record(LogicalDecodingContext *ctx)
+{
+	JsonLinesDecodingData *data = ctx->output_plugin_private;
+
+	appendStringInfoString(&data->buf, "}\n");
+
+	if (data->buf.len >= data->batch_size)
+		flush_records(ctx, false);
+}
+
+static void
+jsonlines_decode_begin_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn)
+{
+	JsonLinesDecodingData *data = ctx->output_plugin_private;
+
+	resetStringInfo(&data->buf);
+}
+
+static void
+jsonlines_decode_commit_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
+							XLogRecPtr commit_lsn)
+{
+	/* transactions without changes produce no output */
+	flush_records(ctx, true);
+}
+
+static void
+jsonlines_decode_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
+						Relation relation, ReorderBufferChange *change)
+{
+	JsonLinesDecodingData *data = ctx->output_plugin_private;
+	TupleDesc	tupdesc = RelationGetDescr(relation);
+	JsonLinesRelEntry *entry;
+	MemoryContext oldcxt;
+	const char *op;
+
+	switch (change->action)
+	{
+		case REORDER_BUFFER_CHANGE_INSERT:
+			op = "insert";
+			break;
+		case REORDER_BUFFER_CHANGE_UPDATE:
+			op = "update";
+			break;
+		case REORDER_BUFFER_CHANGE_DELETE:
+			op = "delete";
+			break;
+		default:
+			Assert(false);
+			return;
+	}
+
+	entry = get_rel_entry(data, relation);
+
+	/* Avoid leaking memory by using and resetting our own context */
+	oldcxt = MemoryContextSwitchTo(data->context);
+
+	begin_record(data, txn, change->lsn, op, entry);
+
+	if (change->data.tp.newtuple != NULL)
+	{
+		appendStringInfoString(&data->buf, ",\"new\":");
+		append_tuple(&data->buf, entry->encoder, tupdesc,
+					 change->data.tp.newtuple, false);
+	}
+
+	/*
+	 * The old key or, with REPLICA IDENTITY FULL, the whole old row.  The
+	 * non-key columns of an old key are NULL, so leave them out.
+	 */
+	if (change->data.tp.oldtuple != NULL)
+	{
+		appendStringInfoString(&data->buf, ",\"old\":");
+		append_tuple(&data->buf, entry->encoder, tupdesc,
+					 change->data.tp.oldtuple,
+					 relation->rd_rel->relreplident != REPLICA_IDENTITY_FULL);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextReset(data->context);
+
+	end_record(ctx);
+}
+
+static void
+jsonlines_decode_truncate(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
+						  int nrelations, Relation relations[],
+						  ReorderBufferChange *change)
+{
+	JsonLinesDecodingData *data = ctx->output_plugin_private;
+
+	for (int i = 0; i < nrelations; i++)
+	{
+		JsonLinesRelEntry *entry = get_rel_entry(data, relations[i]);
+
+		begin_record(data, txn, change->lsn, "truncate", entry);
+		end_record(ctx);
+	}
+}
@@ -0,0 +1,960 @@
+/*--------------------------------------------------------------------------
+ *
+ * jsonlines_fdw.c
+ *		Foreign-data wrapper for JSON Lines files.
+ *
+ * The file is read through COPY FROM with the jsonlines format, so the
+ * foreign tables accept the same options as COPY ('mode', 'column_paths' and
+ * 'extra_keys_column') and gzip-compressed files are read transparently.
+ *
+ * Like file_fdw, the columns the query needs are passed to COPY with the
+ * 'convert_selectively' option, so the keys of the other columns are never
+ * decoded.  COPY still reads all the columns, so that it doesn't evaluate the
+ * default expressions of the others.  This is not done with
+ * 'extra_keys_column', whose value depends on which columns are decoded.
+ *
+ * Uncompressed files in 'lines' mode can be scanned in parallel.  The file is
+ * divided into chunks that the participants claim one at a time, and each
+ * participant feeds the lines starting within its chunks to its COPY through
+ * a data source callback.  Compressed files and the other modes can't be
+ * split, and are scanned by a single process.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		jsonlines_fdw.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "access/htup_details.h"
+#include "access/reloptions.h"
+#include "access/sysattr.h"
+#include "access/table.h"
+#include "catalog/pg_authid.h"
+#include "catalog/pg_foreign_table.h"
+#include "commands/copy.h"
+#include "commands/defrem.h"
+#include "foreign/fdwapi.h"
+#include "foreign/foreign.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
+#include "optimizer/planmain.h"
+#include "optimizer/restrictinfo.h"
+#include "port/atomics.h"
+#include "storage/fd.h"
+#include "utils/acl.h"
+#include "utils/rel.h"
+#include "utils/wait_event.h"
+
+#ifdef HAVE_LIBZ
+#include "zlib.h"
+#endif
+
+#include "pg_custom_copy_formats.h"
+
+PG_FUNCTION_INFO_V1(jsonlines_fdw_handler);
+PG_FUNCTION_INFO_V1(jsonlines_fdw_validator);
+
+/* Size of the chunks of a parallel scan */
+#define JSONLINES_FDW_CHUNK_SIZE	(8 * 1024 * 1024)
+
+/* Number of bytes read from the head of the file to estimate the row size */
+#define JSONLINES_FDW_SAMPLE_SIZE	65536
+
+/*
+ * Valid options for jsonlines_fdw foreign tables.  Apart from 'filename',
+ * these are passed to COPY as is.
+ */
+static const char *const valid_options[] = {
+	"filename",
+	"mode",
+	"column_paths",
+	"extra_keys_column",
+	NULL
+};
+
+/*
+ * Planner information.
+ */
+typedef struct JsonLinesFdwPlanState
+{
+	char	   *filename;
+	List	   *options;		/* COPY options */
+	bool		splittable;		/* can be scanned in parallel? */
+	BlockNumber pages;			/* size of the file in pages */
+	double		ntuples;		/* estimated number of rows */
+} JsonLinesFdwPlanState;
+
+/*
+ * State shared by the participants of a parallel scan.
+ */
+typedef struct JsonLinesFdwShared
+{
+	pg_atomic_uint64 next_offset;	/* start of the next chunk to claim */
+} JsonLinesFdwShared;
+
+/*
+ * Execution state.
+ */
+typedef struct JsonLinesFdwScanState
+{
+	char	   *filename;
+	List	   *options;		/* COPY options, including the format */
+	bool		splittable;
+	CopyFromState cstate;
+
+	/* The rest is used only when the file is read in chunks */
+	JsonLinesFdwShared *shared; /* NULL if not a parallel scan */
+	bool		claimed_all;	/* non-parallel scan claimed the file */
+	File		file;
+	off_t		file_size;
+	bool		has_chunk;		/* currently reading a chunk? */
+	off_t		pos;			/* next byte to feed */
+	off_t		chunk_end;		/* end of the current chunk */
+	bool		in_tail;		/* feeding the line crossing chunk_end */
+	char		last_byte;		/* last byte fed */
+} JsonLinesFdwScanState;
+
+/*
+ * The scan being read by the data source callback.  COPY offers no way to
+ * pass a pointer to the callback, but it's only called from NextCopyFrom(),
+ * so this is set before each call of it.
+ */
+static JsonLinesFdwScanState *current_scan = NULL;
+
+/*
+ * Helper functions
+ */
+
+static bool
+is_valid_option(const char *option, Oid context)
+{
+	if (context != ForeignTableRelationId)
+		return false;
+
+	for (int i = 0; valid_options[i] != NULL; i++)
+	{
+		if (strcmp(valid_options[i], option) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Validate the options of the jsonlines_fdw objects.
+ */
+Datum
+jsonlines_fdw_validator(PG_FUNCTION_ARGS)
+{
+	List	   *options_list = untransformRelOptions(PG_GETARG_DATUM(0));
+	Oid			catalog = PG_GETARG_OID(1);
+	DefElem    *filename = NULL;
+	ListCell   *cell;
+
+	foreach(cell, options_list)
+	{
+		DefElem    *def = (DefElem *) lfirst(cell);
+
+		if (!is_valid_option(def->defname, catalog))
+		{
+			StringInfoData buf;
+
+			initStringInfo(&buf);
+			if (catalog == ForeignTableRelationId)
+			{
+				for (int i = 0; valid_options[i] != NULL; i++)
+					appendStringInfo(&buf, "%s%s", i > 0 ? ", " : "",
+									 valid_options[i]);
+			}
+
+			ereport(ERROR,
+					(errcode(ERRCODE_FDW_INVALID_OPTION_NAME),
+					 errmsg("invalid option \"%s\"", def->defname),
+					 buf.len > 0
+					 ? errhint("Valid options in this context are: %s",
+							   buf.data)
+					 : errhint("There are no valid options in this context.")));
+		}
+
+		if (strcmp(def->defname, "filename") == 0)
+		{
+			if (filename)
+				errorConflictingDefElem(def, NULL);
+
+			/* Like file_fdw, reading server files needs the privileges */
+			if (!has_privs_of_role(GetUserId(), ROLE_PG_READ_SERVER_FILES))
+				ereport(ERROR,
+						(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+						 errmsg("permission denied to set the \"%s\" option of a jsonlines_fdw foreign table",
+								"filename"),
+						 errdetail("Only roles with privileges of the \"%s\" role may set this option.",
+								   "pg_read_server_files")));
+
+			filename = def;
+		}
+	}
+
+	if (catalog == ForeignTableRelationId && filename == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_DYNAMIC_PARAMETER_VALUE_NEEDED),
+				 errmsg("filename is required for jsonlines_fdw foreign tables")));
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Fetch the filename and the COPY options of the foreign table.
+ */
+static void
+jsonlines_fdw_get_options(Oid foreigntableid, char **filename,
+						  List **options)
+{
+	ForeignTable *table = GetForeignTable(foreigntableid);
+	ListCell   *lc;
+
+	*filename = NULL;
+	*options = NIL;
+
+	foreach(lc, table->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "filename") == 0)
+			*filename = defGetString(def);
+		else
+			*options = lappend(*options, def);
+	}
+
+	if (*filename == NULL)
+		elog(ERROR, "filename is required for jsonlines_fdw foreign tables");
+}
+
+/*
+ * Can the file be divided into chunks at line boundaries?
+ */
+static bool
+jsonlines_fdw_is_splittable(const char *filename, List *options)
+{
+	ListCell   *lc;
+
+	if (CopyInputDetectCompression(filename) != PG_COMPRESSION_NONE)
+		return false;
+
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "mode") == 0 &&
+			strcmp(defGetString(def), "lines") != 0)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Return the average length of the lines at the head of the file, or 0 if
+ * it can't be determined.
+ */
+static double
+jsonlines_fdw_sample_line_length(const char *filename, bool compressed)
+{
+	char	   *buf = palloc(JSONLINES_FDW_SAMPLE_SIZE);
+	int			nread = -1;
+	int			nlines = 0;
+	int			last_end = 0;
+
+	if (!compressed)
+	{
+		int			fd = OpenTransientFile(filename, O_RDONLY | PG_BINARY);
+
+		if (fd >= 0)
+		{
+			nread = read(fd, buf, JSONLINES_FDW_SAMPLE_SIZE);
+			CloseTransientFile(fd);
+		}
+	}
+#ifdef HAVE_LIBZ
+	else
+	{
+		gzFile		gz = gzopen(filename, "rb");
+
+		if (gz != NULL)
+		{
+			nread = gzread(gz, buf, JSONLINES_FDW_SAMPLE_SIZE);
+			gzclose(gz);
+		}
+	}
+#endif
+
+	for (int i = 0; i < nread; i++)
+	{
+		if (buf[i] == '\n')
+		{
+			nlines++;
+			last_end = i + 1;
+		}
+	}
+
+	pfree(buf);
+
+	if (nlines > 0)
+		return (double) last_end / nlines;
+
+	/* A single line, possibly longer than the sample */
+	return nread > 0 ? (double) nread : 0;
+}
+
+/*
+ * Return the uncompressed size of a gzip file from its trailer, which holds
+ * the size modulo 2^32 of the last member.  Returns -1 on failure.
+ */
+static off_t
+jsonlines_fdw_gzip_size(const char *filename, off_t file_size)
+{
+	int			fd;
+	unsigned char trailer[4];
+	off_t		size = -1;
+
+	if (file_size < 18)			/* smaller than the gzip header and trailer */
+		return -1;
+
+	fd = OpenTransientFile(filename, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+		return -1;
+
+	if (pg_pread(fd, trailer, 4, file_size - 4) == 4)
+		size = (off_t) trailer[0] | ((off_t) trailer[1] << 8) |
+			((off_t) trailer[2] << 16) | ((off_t) trailer[3] << 24);
+
+	CloseTransientFile(fd);
+
+	/* The size wrapped around, or the file has several members */
+	if (size >= 0 && size < file_size)
+		size = -1;
+
+	return size;
+}
+
+/*
+ * Estimate the size of the foreign table.
+ */
+static void
+estimate_size(PlannerInfo *root, RelOptInfo *baserel,
+			  JsonLinesFdwPlanState *fdw_private)
+{
+	struct stat stat_buf;
+	bool		compressed;
+	double		data_size;
+	double		line_length;
+	double		nrows;
+
+	/* If the file is not there, assume a small file like file_fdw does */
+	if (stat(fdw_private->filename, &stat_buf) < 0)
+		stat_buf.st_size = 10 * BLCKSZ;
+
+	fdw_private->pages = (stat_buf.st_size + (BLCKSZ - 1)) / BLCKSZ;
+	if (fdw_private->pages < 1)
+		fdw_private->pages = 1;
+
+	compressed = CopyInputDetectCompression(fdw_private->filename) != PG_COMPRESSION_NONE;
+	data_size = stat_buf.st_size;
+	if (compressed)
+	{
+		off_t		size = jsonlines_fdw_gzip_size(fdw_private->filename,
+												   stat_buf.st_size);
+
+		/* Otherwise assume a typical compression ratio for text */
+		data_size = size >= 0 ? size : stat_buf.st_size * 5.0;
+	}
+
+	line_length = jsonlines_fdw_sample_line_length(fdw_private->filename,
+												   compressed);
+	if (line_length <= 0)
+		line_length = MAXALIGN(baserel->reltarget->width) +
+			MAXALIGN(SizeofHeapTupleHeader);
+
+	fdw_private->ntuples = clamp_row_est(data_size / line_length);
+	baserel->tuples = fdw_private->ntuples;
+
+	nrows = fdw_private->ntuples *
+		clauselist_selectivity(root, baserel->baserestrictinfo, 0,
+							   JOIN_INNER, NULL);
+	baserel->rows = clamp_row_est(nrows);
+}
+
+/*
+ * Estimate the costs of scanning the foreign table, split into the I/O cost
+ * and the CPU cost so that the latter can be divided among the parallel
+ * workers.
+ */
+static void
+estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
+			   JsonLinesFdwPlanState *fdw_private, Cost *startup_cost,
+			   Cost *io_cost, Cost *cpu_cost)
+{
+	Cost		cpu_per_tuple;
+
+	*startup_cost = baserel->baserestrictcost.startup;
+	*io_cost = seq_page_cost * fdw_private->pages;
+
+	/* Parsing JSON costs more than the built-in text formats */
+	cpu_per_tuple = cpu_tuple_cost * 20 + baserel->baserestrictcost.per_tuple;
+	*cpu_cost = cpu_per_tuple * fdw_private->ntuples;
+}
+
+/*
+ * Divisor of the CPU cost of a parallel scan, same as the one the core
+ * planner uses for sequential scans.
+ */
+static double
+parallel_divisor(int parallel_workers)
+{
+	double		divisor = parallel_workers;
+
+	if (parallel_leader_participation)
+	{
+		double		leader_contribution = 1.0 - (0.3 * parallel_workers);
+
+		if (leader_contribution > 0)
+			divisor += leader_contribution;
+	}
+
+	return divisor;
+}
+
+/*
+ * FDW callback routines
+ */
+
+static void
+jsonlinesGetForeignRelSize(PlannerInfo *root, RelOptInfo *baserel,
+						   Oid foreigntableid)
+{
+	JsonLinesFdwPlanState *fdw_private = palloc0(sizeof(JsonLinesFdwPlanState));
+
+	jsonlines_fdw_get_options(foreigntableid, &fdw_private->filename,
+							  &fdw_private->options);
+	fdw_private->splittable =
+		jsonlines_fdw_is_splittable(fdw_private->filename,
+									fdw_private->options);
+
+	estimate_size(root, baserel, fdw_private);
+
+	baserel->fdw_private = fdw_private;
+}
+
+static void
+jsonlinesGetForeignPaths(PlannerInfo *root, RelOptInfo *baserel,
+						 Oid foreigntableid)
+{
+	JsonLinesFdwPlanState *fdw_private = baserel->fdw_private;
+	Cost		startup_cost;
+	Cost		io_cost;
+	Cost		cpu_cost;
+
+	estimate_costs(root, baserel, fdw_private, &startup_cost, &io_cost,
+				   &cpu_cost);
+
+	add_path(baserel, (Path *)
+			 create_foreignscan_path(root, baserel,
+									 NULL,	/* default pathtarget */
+									 baserel->rows,
+									 0,
+									 startup_cost,
+									 startup_cost + io_cost + cpu_cost,
+									 NIL,	/* no pathkeys */
+									 NULL,	/* no outer rel either */
+									 NULL,	/* no extra plan */
+									 NIL,	/* no fdw_restrictinfo list */
+									 NIL));
+
+	/* Add a partial path if the file can be divided among workers */
+	if (fdw_private->splittable && baserel->consider_parallel)
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(baserel, fdw_private->pages,
+												   -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+		{
+			double		divisor = parallel_divisor(parallel_workers);
+			ForeignPath *path;
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,
+										   clamp_row_est(baserel->rows / divisor),
+										   0,
+										   startup_cost,
+										   startup_cost + io_cost + cpu_cost / divisor,
+										   NIL,
+										   NULL,
+										   NULL,
+										   NIL,
+										   NIL);
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+
+			add_partial_path(baserel, (Path *) path);
+		}
+	}
+}
+
+/*
+ * Find the columns needed by the query.  Returns false if all the columns
+ * are needed, else sets *columns to the list of their names.
+ */
+static bool
+jsonlines_fdw_needed_columns(PlannerInfo *root, RelOptInfo *baserel,
+							 Oid foreigntableid, List **columns)
+{
+	JsonLinesFdwPlanState *fdw_private = baserel->fdw_private;
+	Bitmapset  *attrs_used = NULL;
+	Relation	rel;
+	TupleDesc	tupdesc;
+	int			numattrs = 0;
+	ListCell   *lc;
+
+	*columns = NIL;
+
+	/*
+	 * The extra keys column holds the keys that feed no decoded column, so
+	 * decode them all to keep it the same whichever columns are queried.
+	 */
+	foreach(lc, fdw_private->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "extra_keys_column") == 0)
+			return false;
+	}
+
+	pull_varattnos((Node *) baserel->reltarget->exprs, baserel->relid,
+				   &attrs_used);
+	foreach(lc, baserel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		pull_varattnos((Node *) rinfo->clause, baserel->relid, &attrs_used);
+	}
+
+	/* A whole-row reference needs all the columns */
+	if (bms_is_member(0 - FirstLowInvalidHeapAttributeNumber, attrs_used))
+		return false;
+
+	rel = table_open(foreigntableid, AccessShareLock);
+	tupdesc = RelationGetDescr(rel);
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+		if (attr->attisdropped)
+			continue;
+		numattrs++;
+
+		if (bms_is_member(attr->attnum - FirstLowInvalidHeapAttributeNumber,
+						  attrs_used))
+			*columns = lappend(*columns,
+							   makeString(pstrdup(NameStr(attr->attname))));
+	}
+
+	table_close(rel, AccessShareLock);
+
+	return list_length(*columns) < numattrs;
+}
+
+static ForeignScan *
+jsonlinesGetForeignPlan(PlannerInfo *root, RelOptInfo *baserel,
+						Oid foreigntableid, ForeignPath *best_path,
+						List *tlist, List *scan_clauses, Plan *outer_plan)
+{
+	Index		scan_relid = baserel->relid;
+	List	   *columns;
+	List	   *fdw_private = NIL;
+
+	/* Check all the quals in the executor */
+	scan_clauses = extract_actual_clauses(scan_clauses, false);
+
+	/* Decode only the columns the query needs, if not all */
+	if (jsonlines_fdw_needed_columns(root, baserel, foreigntableid, &columns))
+		fdw_private = list_make1(makeDefElem("convert_selectively",
+											 (Node *) columns, -1));
+
+	return make_foreignscan(tlist,
+							scan_clauses,
+							scan_relid,
+							NIL,	/* no expressions to evaluate */
+							fdw_private,
+							NIL,	/* no custom tlist */
+							NIL,	/* no remote quals */
+							outer_plan);
+}
+
+/*
+ * Claim the next chunk of the file to read.  Returns false if there are no
+ * more chunks.
+ *
+ * A chunk owns the lines starting within it.  So unless the chunk is at the
+ * start of the file, we skip the line that started in the previous chunk, and
+ * after the end of the chunk we continue up to the end of the line crossing
+ * it.
+ */
+static bool
+jsonlines_fdw_claim_chunk(JsonLinesFdwScanState *festate)
+{
+	char		buf[BLCKSZ];
+
+	for (;;)
+	{
+		off_t		start;
+		off_t		pos;
+		bool		found = false;
+
+		if (festate->shared != NULL)
+		{
+			start = pg_atomic_fetch_add_u64(&festate->shared->next_offset,
+											JSONLINES_FDW_CHUNK_SIZE);
+			festate->chunk_end = Min(start + JSONLINES_FDW_CHUNK_SIZE,
+									 festate->file_size);
+		}
+		else
+		{
+			if (festate->claimed_all)
+				return false;
+			festate->claimed_all = true;
+			start = 0;
+			festate->chunk_end = festate->file_size;
+		}
+
+		if (start >= festate->file_size)
+			return false;
+
+		if (start == 0)
+		{
+			festate->pos = 0;
+			break;
+		}
+
+		/* Find the first line starting at or after 'start' */
+		pos = start - 1;
+		while (!found && pos < festate->chunk_end)
+		{
+			int			nread;
+			char	   *nl;
+
+			nread = FileRead(festate->file, buf, sizeof(buf), pos,
+							 WAIT_EVENT_COPY_FILE_READ);
+			if (nread < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read file \"%s\": %m",
+								festate->filename)));
+			if (nread == 0)
+				break;
+
+			nl = memchr(buf, '\n', nread);
+			if (nl != NULL)
+			{
+				pos += nl - buf + 1;
+				found = true;
+			}
+			else
+				pos += nread;
+		}
+
+		/* No line starts in this chunk; try the next one */
+		if (!found || pos >= festate->chunk_end)
+			continue;
+
+		festate->pos = pos;
+		break;
+	}
+
+	festate->has_chunk = true;
+	festate->in_tail = false;
+
+	return true;
+}
+
+/*
+ * Data source callback of COPY for the files read in chunks.
+ */
+static int
+jsonlines_fdw_read_data(void *outbuf, int minread, int maxread)
+{
+	JsonLinesFdwScanState *festate = current_scan;
+
+	Assert(festate != NULL);
+
+	for (;;)
+	{
+		int			nread;
+		int			toread = maxread;
+
+		if (!festate->has_chunk && !jsonlines_fdw_claim_chunk(festate))
+			return 0;
+
+		if (!festate->in_tail)
+		{
+			if (festate->pos < festate->chunk_end)
+				toread = Min(maxread, festate->chunk_end - festate->pos);
+			else
+			{
+				/* Done unless a line crosses the end of the chunk */
+				festate->in_tail = true;
+				if (festate->last_byte == '\n')
+				{
+					festate->has_chunk = false;
+					continue;
+				}
+			}
+		}
+
+		nread = FileRead(festate->file, outbuf, toread, festate->pos,
+						 WAIT_EVENT_COPY_FILE_READ);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							festate->filename)));
+		if (nread == 0)
+		{
+			/* EOF */
+			festate->has_chunk = false;
+			continue;
+		}
+
+		if (festate->in_tail)
+		{
+			char	   *nl = memchr(outbuf, '\n', nread);
+
+			/* The line ends here, and so does the chunk */
+			if (nl != NULL)
+			{
+				nread = nl - (char *) outbuf + 1;
+				festate->has_chunk = false;
+			}
+		}
+
+		festate->pos += nread;
+		festate->last_byte = ((char *) outbuf)[nread - 1];
+
+		return nread;
+	}
+}
+
+/*
+ * Set up COPY to read the file.
+ */
+static void
+jsonlines_fdw_begin_copy(ForeignScanState *node, JsonLinesFdwScanState *festate)
+{
+	festate->has_chunk = false;
+	festate->claimed_all = false;
+	festate->file = -1;
+
+	if (festate->splittable)
+	{
+		festate->file = PathNameOpenFile(festate->filename, O_RDONLY | PG_BINARY);
+		if (festate->file < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\" for reading: %m",
+							festate->filename)));
+		festate->file_size = FileSize(festate->file);
+		if (festate->file_size < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not determine size of file \"%s\": %m",
+							festate->filename)));
+	}
+
+	festate->cstate = BeginCopyFrom(NULL,
+									node->ss.ss_currentRelation,
+									NULL,
+									festate->splittable ? NULL : festate->filename,
+									false,
+									festate->splittable ? jsonlines_fdw_read_data : NULL,
+									NIL,
+									festate->options);
+}
+
+static void
+jsonlines_fdw_end_copy(JsonLinesFdwScanState *festate)
+{
+	if (festate->cstate)
+		EndCopyFrom(festate->cstate);
+	festate->cstate = NULL;
+
+	if (festate->file >= 0)
+		FileClose(festate->file);
+	festate->file = -1;
+}
+
+static void
+jsonlinesBeginForeignScan(ForeignScanState *node, int eflags)
+{
+	ForeignScan *plan = (ForeignScan *) node->ss.ps.plan;
+	JsonLinesFdwScanState *festate;
+	char	   *filename;
+	List	   *options;
+
+	jsonlines_fdw_get_options(RelationGetRelid(node->ss.ss_currentRelation),
+							  &filename, &options);
+
+	festate = palloc0(sizeof(JsonLinesFdwScanState));
+	festate->filename = filename;
+	festate->splittable = jsonlines_fdw_is_splittable(filename, options);
+	festate->options = lappend(options,
+							   makeDefElem("format",
+										   (Node *) makeString("jsonlines"),
+										   -1));
+	/* Add the options from the plan (currently only convert_selectively) */
+	festate->options = list_concat(festate->options, plan->fdw_private);
+	festate->file = -1;
+
+	node->fdw_state = festate;
+
+	/* Do nothing in EXPLAIN (no ANALYZE) case */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	jsonlines_fdw_begin_copy(node, festate);
+}
+
+static TupleTableSlot *
+jsonlinesIterateForeignScan(ForeignScanState *node)
+{
+	JsonLinesFdwScanState *festate = (JsonLinesFdwScanState *) node->fdw_state;
+	EState	   *estate = node->ss.ps.state;
+	ExprContext *econtext = GetPerTupleExprContext(estate);
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	ErrorContextCallback errcallback;
+	MemoryContext oldcontext;
+	bool		found;
+
+	/* Set up callback to identify error line number */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) festate->cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	ExecClearTuple(slot);
+
+	ResetPerTupleExprContext(estate);
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	current_scan = festate;
+	found = NextCopyFrom(festate->cstate, econtext,
+						 slot->tts_values, slot->tts_isnull);
+	current_scan = NULL;
+
+	if (found)
+		ExecStoreVirtualTuple(slot);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	error_context_stack = errcallback.previous;
+
+	return slot;
+}
+
+static void
+jsonlinesReScanForeignScan(ForeignScanState *node)
+{
+	JsonLinesFdwScanState *festate = (JsonLinesFdwScanState *) node->fdw_state;
+
+	jsonlines_fdw_end_copy(festate);
+	jsonlines_fdw_begin_copy(node, festate);
+}
+
+static void
+jsonlinesEndForeignScan(ForeignScanState *node)
+{
+	JsonLinesFdwScanState *festate = (JsonLinesFdwScanState *) node->fdw_state;
+
+	/* if festate is NULL, we are in EXPLAIN; nothing to do */
+	if (festate)
+		jsonlines_fdw_end_copy(festate);
+}
+
+static bool
+jsonlinesIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
+								   RangeTblEntry *rte)
+{
+	return true;
+}
+
+static Size
+jsonlinesEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(JsonLinesFdwShared);
+}
+
+static void
+jsonlinesInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+								  void *coordinate)
+{
+	JsonLinesFdwScanState *festate = (JsonLinesFdwScanState *) node->fdw_state;
+	JsonLinesFdwShared *shared = (JsonLinesFdwShared *) coordinate;
+
+	pg_atomic_init_u64(&shared->next_offset, 0);
+	festate->shared = shared;
+}
+
+static void
+jsonlinesReInitializeDSMForeignScan(ForeignScanState *node,
+									ParallelContext *pcxt, void *coordinate)
+{
+	JsonLinesFdwShared *shared = (JsonLinesFdwShared *) coordinate;
+
+	pg_atomic_write_u64(&shared->next_offset, 0);
+}
+
+static void
+jsonlinesInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+									 void *coordinate)
+{
+	JsonLinesFdwScanState *festate = (JsonLinesFdwScanState *) node->fdw_state;
+
+	festate->shared = (JsonLinesFdwShared *) coordinate;
+}
+
+/*
+ * Foreign-data wrapper handler function: return a struct with pointers to
+ * the callback routines.
+ */
+Datum
+jsonlines_fdw_handler(PG_FUNCTION_ARGS)
+{
+	FdwRoutine *fdwroutine = makeNode(FdwRoutine);
+
+	fdwroutine->GetForeignRelSize = jsonlinesGetForeignRelSize;
+	fdwroutine->GetForeignPaths = jsonlinesGetForeignPaths;
+	fdwroutine->GetForeignPlan = jsonlinesGetForeignPlan;
+	fdwroutine->BeginForeignScan = jsonlinesBeginForeignScan;
+	fdwroutine->IterateForeignScan = jsonlinesIterateForeignScan;
+	fdwroutine->ReScanForeignScan = jsonlinesReScanForeignScan;
+	fdwroutine->EndForeignScan = jsonlinesEndForeignScan;
+	fdwroutine->IsForeignScanParallelSafe = jsonlinesIsForeignScanParallelSafe;
+	fdwroutine->EstimateDSMForeignScan = jsonlinesEstimateDSMForeignScan;
+	fdwroutine->InitializeDSMForeignScan = jsonlinesInitializeDSMForeignScan;
+	fdwroutine->ReInitializeDSMForeignScan = jsonlinesReInitializeDSMForeignScan;
+	fdwroutine->InitializeWorkerForeignScan = jsonlinesInitializeWorkerForeignScan;
+
+	PG_RETURN_POINTER(fdwroutine);
+}
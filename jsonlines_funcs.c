@@ -0,0 +1,579 @@
+/*--------------------------------------------------------------------------
+ *
+ * jsonlines_funcs.c
+ *		SQL functions encoding and decoding JSON Lines data.
+ *
+ * jsonlines_to_record() decodes a single JSON object and jsonlines_read()
+ * reads a whole file.  Both fill the columns of the given row type with the
+ * same decoder as COPY FROM with the jsonlines format, which converts each
+ * value straight into the column type.
+ *
+ * The jsonlines_agg() aggregate encodes rows with the encoder of COPY TO,
+ * appending them to a single buffer per group.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		jsonlines_funcs.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_authid.h"
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/fd.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/jsonb.h"
+#include "utils/memutils.h"
+#include "utils/typcache.h"
+
+#ifdef HAVE_LIBZ
+#include "zlib.h"
+#endif
+
+#include "pg_custom_copy_formats.h"
+
+PG_FUNCTION_INFO_V1(jsonlines_to_record);
+PG_FUNCTION_INFO_V1(jsonlines_read);
+PG_FUNCTION_INFO_V1(jsonlines_agg_transfn);
+PG_FUNCTION_INFO_V1(jsonlines_agg_combinefn);
+PG_FUNCTION_INFO_V1(jsonlines_agg_serialfn);
+PG_FUNCTION_INFO_V1(jsonlines_agg_deserialfn);
+PG_FUNCTION_INFO_V1(jsonlines_agg_finalfn);
+
+#define JSONLINES_READ_BUF_SIZE 65536
+
+/*
+ * Decoder cached in fn_extra across the calls of jsonlines_to_record().
+ */
+typedef struct JsonLinesRecordCache
+{
+	Oid			typid;
+	TupleDesc	tupdesc;
+	JsonLinesRowDecoder *decoder;
+	Datum	   *values;
+	bool	   *nulls;
+} JsonLinesRecordCache;
+
+/*
+ * Encoder cached in fn_extra across the calls of jsonlines_agg_transfn().
+ */
+typedef struct JsonLinesAggCache
+{
+	Oid			typid;
+	int32		typmod;
+	TupleDesc	tupdesc;
+	JsonLinesRowEncoder *encoder;
+	Datum	   *values;
+	bool	   *nulls;
+} JsonLinesAggCache;
+
+/*
+ * A file being read line by line by jsonlines_read().
+ */
+typedef struct JsonLinesFile
+{
+	const char *filename;
+	FILE	   *file;
+#ifdef HAVE_LIBZ
+	gzFile		gzfile;
+#endif
+	char	   *buf;
+	int			buf_index;
+	int			buf_len;
+	bool		reached_eof;
+	uint64		lineno;
+	StringInfoData line;
+} JsonLinesFile;
+
+/*
+ * Create a decoder filling all the columns of the tuple descriptor.
+ */
+static JsonLinesRowDecoder *
+create_record_decoder(TupleDesc tupdesc)
+{
+	List	   *attnumlist = NIL;
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		if (!TupleDescAttr(tupdesc, i)->attisdropped)
+			attnumlist = lappend_int(attnumlist, i + 1);
+	}
+
+	return JsonLinesCreateRowDecoder(tupdesc, attnumlist, NULL, NULL, NULL,
+									 NULL);
+}
+
+/*
+ * Parse the JSON text and decode it into values/nulls.
+ */
+static void
+decode_record(JsonLinesRowDecoder *dec, const char *json, Datum *values,
+			  bool *nulls)
+{
+	Jsonb	   *jb;
+
+	jb = DatumGetJsonbP(DirectFunctionCall1(jsonb_in, CStringGetDatum(json)));
+
+	/* dropped columns are not decoded */
+	memset(nulls, true, sizeof(bool) * dec->tupdesc->natts);
+
+	JsonLinesDecodeRow(dec, jb, values, nulls, NULL);
+}
+
+/*
+ * jsonlines_to_record(line text, rowtype anyelement) returns anyelement
+ *
+ * Decode a JSON object into a row of the type of 'rowtype'.  The value of
+ * 'rowtype' is not used, like in jsonb_populate_record().
+ */
+Datum
+jsonlines_to_record(PG_FUNCTION_ARGS)
+{
+	Oid			typid = get_fn_expr_argtype(fcinfo->flinfo, 1);
+	JsonLinesRecordCache *cache = (JsonLinesRecordCache *) fcinfo->flinfo->fn_extra;
+	HeapTuple	tuple;
+	char	   *json;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	if (!type_is_rowtype(typid))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("second argument of jsonlines_to_record must be a row type")));
+
+	if (cache == NULL || cache->typid != typid)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+		TupleDesc	tupdesc;
+
+		tupdesc = lookup_rowtype_tupdesc_copy(typid, -1);
+
+		cache = palloc(sizeof(JsonLinesRecordCache));
+		cache->typid = typid;
+		cache->tupdesc = tupdesc;
+		cache->decoder = create_record_decoder(tupdesc);
+		cache->values = palloc(sizeof(Datum) * Max(tupdesc->natts, 1));
+		cache->nulls = palloc(sizeof(bool) * Max(tupdesc->natts, 1));
+
+		MemoryContextSwitchTo(oldcxt);
+
+		fcinfo->flinfo->fn_extra = cache;
+	}
+
+	json = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	decode_record(cache->decoder, json, cache->values, cache->nulls);
+
+	tuple = heap_form_tuple(cache->tupdesc, cache->values, cache->nulls);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+static void
+jsonlines_file_open(JsonLinesFile *jf, const char *filename)
+{
+	memset(jf, 0, sizeof(JsonLinesFile));
+	jf->filename = filename;
+
+	if (CopyInputDetectCompression(filename) == PG_COMPRESSION_GZIP)
+	{
+#ifdef HAVE_LIBZ
+		jf->gzfile = gzopen(filename, "rb");
+		if (jf->gzfile == NULL)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\" for reading: %m",
+							filename)));
+#else
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("gzip compression is not supported by this build")));
+#endif
+	}
+	else
+	{
+		jf->file = AllocateFile(filename, PG_BINARY_R);
+		if (jf->file == NULL)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\" for reading: %m",
+							filename)));
+	}
+
+	jf->buf = palloc(JSONLINES_READ_BUF_SIZE);
+	initStringInfo(&jf->line);
+}
+
+static void
+jsonlines_file_load(JsonLinesFile *jf)
+{
+	int			nread;
+
+#ifdef HAVE_LIBZ
+	if (jf->gzfile != NULL)
+	{
+		nread = gzread(jf->gzfile, jf->buf, JSONLINES_READ_BUF_SIZE);
+		if (nread < 0)
+		{
+			int			errnum;
+			const char *msg = gzerror(jf->gzfile, &errnum);
+
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %s", jf->filename,
+							errnum == Z_ERRNO ? strerror(errno) : msg)));
+		}
+	}
+	else
+#endif
+	{
+		nread = fread(jf->buf, 1, JSONLINES_READ_BUF_SIZE, jf->file);
+		if (ferror(jf->file))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", jf->filename)));
+	}
+
+	jf->buf_index = 0;
+	jf->buf_len = nread;
+	if (nread == 0)
+		jf->reached_eof = true;
+}
+
+/*
+ * Read the next line into jf->line.  Returns false at the end of the file.
+ */
+static bool
+jsonlines_file_read_line(JsonLinesFile *jf)
+{
+	resetStringInfo(&jf->line);
+
+	for (;;)
+	{
+		char	   *start;
+		char	   *nl;
+
+		if (jf->buf_index >= jf->buf_len)
+		{
+			if (!jf->reached_eof)
+				jsonlines_file_load(jf);
+			if (jf->reached_eof)
+				break;
+		}
+
+		start = jf->buf + jf->buf_index;
+		nl = memchr(start, '\n', jf->buf_len - jf->buf_index);
+		if (nl != NULL)
+		{
+			appendBinaryStringInfo(&jf->line, start, nl - start);
+			jf->buf_index += nl - start + 1;
+			jf->lineno++;
+			return true;
+		}
+
+		appendBinaryStringInfo(&jf->line, start, jf->buf_len - jf->buf_index);
+		jf->buf_index = jf->buf_len;
+	}
+
+	/* the last line may lack the newline */
+	if (jf->line.len > 0)
+	{
+		jf->lineno++;
+		return true;
+	}
+
+	return false;
+}
+
+static void
+jsonlines_file_close(JsonLinesFile *jf)
+{
+#ifdef HAVE_LIBZ
+	if (jf->gzfile != NULL)
+		gzclose(jf->gzfile);
+	jf->gzfile = NULL;
+#endif
+	if (jf->file != NULL)
+		FreeFile(jf->file);
+	jf->file = NULL;
+}
+
+static void
+jsonlines_read_error_callback(void *arg)
+{
+	JsonLinesFile *jf = (JsonLinesFile *) arg;
+
+	errcontext("jsonlines_read, file \"%s\", line %" PRIu64,
+			   jf->filename, jf->lineno);
+}
+
+/*
+ * jsonlines_read(path text, rowtype anyelement) returns setof anyelement
+ *
+ * Read a JSON Lines file, possibly gzip-compressed, into rows of the type of
+ * 'rowtype'.  Empty lines are skipped, and a NULL path returns no rows.
+ */
+Datum
+jsonlines_read(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	char	   *filename;
+	JsonLinesRowDecoder *decoder;
+	JsonLinesFile jf;
+	Datum	   *values;
+	bool	   *nulls;
+	MemoryContext rowcxt;
+	MemoryContext oldcxt;
+	ErrorContextCallback errcallback;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	/* no rows for a NULL path */
+	if (PG_ARGISNULL(0))
+		return (Datum) 0;
+
+	/* Like COPY FROM a file, reading server files needs the privileges */
+	if (!has_privs_of_role(GetUserId(), ROLE_PG_READ_SERVER_FILES))
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("permission denied to read file with jsonlines_read"),
+				 errdetail("Only roles with privileges of the \"%s\" role may read server files.",
+						   "pg_read_server_files")));
+
+	filename = text_to_cstring(PG_GETARG_TEXT_PP(0));
+
+	decoder = create_record_decoder(rsinfo->setDesc);
+	values = palloc(sizeof(Datum) * Max(rsinfo->setDesc->natts, 1));
+	nulls = palloc(sizeof(bool) * Max(rsinfo->setDesc->natts, 1));
+
+	rowcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "jsonlines_read row",
+								   ALLOCSET_DEFAULT_SIZES);
+
+	jsonlines_file_open(&jf, filename);
+
+	/*
+	 * The gzFile is not tracked by any resource owner, so close the file
+	 * ourselves when decoding a line fails.
+	 */
+	PG_TRY();
+	{
+		errcallback.callback = jsonlines_read_error_callback;
+		errcallback.arg = &jf;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		while (jsonlines_file_read_line(&jf))
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			if (jf.line.len == 0)
+				continue;
+
+			MemoryContextReset(rowcxt);
+			oldcxt = MemoryContextSwitchTo(rowcxt);
+
+			decode_record(decoder, jf.line.data, values, nulls);
+			tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values,
+								 nulls);
+
+			MemoryContextSwitchTo(oldcxt);
+		}
+
+		error_context_stack = errcallback.previous;
+	}
+	PG_FINALLY();
+	{
+		jsonlines_file_close(&jf);
+	}
+	PG_END_TRY();
+
+	MemoryContextDelete(rowcxt);
+
+	return (Datum) 0;
+}
+
+/*
+ * jsonlines_agg_transfn(state internal, row record) returns internal
+ *
+ * Append the row as a line to the state, a StringInfo.  NULL rows are
+ * skipped.
+ */
+Datum
+jsonlines_agg_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	StringInfo	state;
+	HeapTupleHeader rec;
+	Oid			typid;
+	int32		typmod;
+	JsonLinesAggCache *cache = (JsonLinesAggCache *) fcinfo->flinfo->fn_extra;
+	HeapTupleData tuple;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "jsonlines_agg_transfn called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (StringInfo) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+	{
+		if (state == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state);
+	}
+
+	if (state == NULL)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(aggcontext);
+
+		state = makeStringInfo();
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	rec = PG_GETARG_HEAPTUPLEHEADER(1);
+	typid = HeapTupleHeaderGetTypeId(rec);
+	typmod = HeapTupleHeaderGetTypMod(rec);
+
+	if (cache == NULL || cache->typid != typid || cache->typmod != typmod)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+		TupleDesc	tupdesc = lookup_rowtype_tupdesc_copy(typid, typmod);
+		List	   *attnumlist = NIL;
+
+		for (int i = 0; i < tupdesc->natts; i++)
+		{
+			if (!TupleDescAttr(tupdesc, i)->attisdropped)
+				attnumlist = lappend_int(attnumlist, i + 1);
+		}
+
+		cache = palloc(sizeof(JsonLinesAggCache));
+		cache->typid = typid;
+		cache->typmod = typmod;
+		cache->tupdesc = tupdesc;
+		cache->encoder = JsonLinesCreateRowEncoder(tupdesc, attnumlist);
+		cache->values = palloc(sizeof(Datum) * Max(tupdesc->natts, 1));
+		cache->nulls = palloc(sizeof(bool) * Max(tupdesc->natts, 1));
+
+		MemoryContextSwitchTo(oldcxt);
+
+		fcinfo->flinfo->fn_extra = cache;
+	}
+
+	tuple.t_len = HeapTupleHeaderGetDatumLength(rec);
+	ItemPointerSetInvalid(&(tuple.t_self));
+	tuple.t_tableOid = InvalidOid;
+	tuple.t_data = rec;
+
+	heap_deform_tuple(&tuple, cache->tupdesc, cache->values, cache->nulls);
+
+	/* the buffer lives in aggcontext, and grows there */
+	JsonLinesEncodeRow(cache->encoder, cache->values, cache->nulls, state);
+	appendStringInfoChar(state, '\n');
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * jsonlines_agg_combinefn(state1 internal, state2 internal) returns internal
+ *
+ * Every line ends with a newline, so the states are simply concatenated.
+ */
+Datum
+jsonlines_agg_combinefn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	StringInfo	state1;
+	StringInfo	state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "jsonlines_agg_combinefn called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (StringInfo) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (StringInfo) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (state1 == NULL)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(aggcontext);
+
+		state1 = makeStringInfo();
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	appendBinaryStringInfo(state1, state2->data, state2->len);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * jsonlines_agg_serialfn(state internal) returns bytea
+ */
+Datum
+jsonlines_agg_serialfn(PG_FUNCTION_ARGS)
+{
+	StringInfo	state;
+	bytea	   *result;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	state = (StringInfo) PG_GETARG_POINTER(0);
+
+	result = (bytea *) palloc(state->len + VARHDRSZ);
+	SET_VARSIZE(result, state->len + VARHDRSZ);
+	memcpy(VARDATA(result), state->data, state->len);
+
+	PG_RETURN_BYTEA_P(result);
+}
+
+/*
+ * jsonlines_agg_deserialfn(bytes bytea, dummy internal) returns internal
+ */
+Datum
+jsonlines_agg_deserialfn(PG_FUNCTION_ARGS)
+{
+	bytea	   *bytes;
+	StringInfo	state;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "jsonlines_agg_deserialfn called in non-aggregate context");
+
+	bytes = PG_GETARG_BYTEA_PP(0);
+
+	state = makeStringInfo();
+	appendBinaryStringInfo(state, VARDATA_ANY(bytes), VARSIZE_ANY_EXHDR(bytes));
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * jsonlines_agg_finalfn(state internal) returns text
+ */
+Datum
+jsonlines_agg_finalfn(PG_FUNCTION_ARGS)
+{
+	StringInfo	state;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	state = PG_ARGISNULL(0) ? NULL : (StringInfo) PG_GETARG_POINTER(0);
+
+	if (state == NULL)
+		PG_RETURN_NULL();
+
+	PG_RETURN_TEXT_P(cstring_to_text_with_len(state->data, state->len));
+}
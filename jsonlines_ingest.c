@@ -0,0 +1,828 @@
+/*--------------------------------------------------------------------------
+ *
+ * jsonlines_ingest.c
+ *		Background worker loading JSON Lines files continuously.
+ *
+ * The worker watches the files and spool directories listed in the
+ * jsonlines_ingest_sources table, and loads the data appended to the files
+ * into the target tables through COPY FROM with the jsonlines format.
+ *
+ * The data is loaded in batches of about ingest_batch_size bytes, each in its
+ * own transaction that also records how far the file has been loaded in the
+ * jsonlines_ingest_files table.  So every line is loaded exactly once even if
+ * the worker or the server stops in the middle.  Only complete lines are
+ * loaded; a line still being written is picked up in a later batch.  The
+ * device and inode numbers of the file are recorded as well, so a file
+ * replaced by a new one at the same path, e.g. by log rotation, is loaded
+ * again from the start.
+ *
+ * Gzip-compressed files can't be read from an offset, so they are loaded as
+ * a whole in a single transaction and are expected not to change afterwards.
+ *
+ * A batch that fails to load, e.g. because of a malformed line, is rolled
+ * back in a subtransaction.  The error is recorded in jsonlines_ingest_files
+ * and the file is marked as done, so that the worker goes on with the other
+ * files instead of retrying the batch forever.
+ *
+ * On Linux, the worker is woken up by inotify when the watched files or
+ * directories change; otherwise it polls them every ingest_naptime.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		jsonlines_ingest.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/pg_type.h"
+#include "commands/copy.h"
+#include "commands/extension.h"
+#include "executor/spi.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "parser/parse_relation.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "storage/fd.h"
+#include "storage/latch.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+#include "utils/snapmgr.h"
+#include "utils/wait_event.h"
+
+#include "pg_custom_copy_formats.h"
+
+PGDLLEXPORT void jsonlines_ingest_main(Datum main_arg);
+
+PG_FUNCTION_INFO_V1(jsonlines_ingest_batch);
+
+/* GUC variables */
+static char *ingest_database = NULL;
+static int	ingest_naptime = 5000;
+static int	ingest_batch_size = 8192;	/* kB */
+
+/* Wait event of the worker while it sleeps between scans */
+static uint32 ingest_wait_event_main = 0;
+
+/*
+ * Range of the file being loaded, read by the data source callback of COPY.
+ * COPY offers no way to pass a pointer to the callback, so this is static.
+ */
+typedef struct JsonLinesIngestRange
+{
+	const char *path;
+	int			fd;
+	off_t		pos;
+	off_t		end;
+} JsonLinesIngestRange;
+
+static JsonLinesIngestRange *current_range = NULL;
+
+/*
+ * A configured source.
+ */
+typedef struct JsonLinesIngestSource
+{
+	char	   *path;
+	Oid			target;
+} JsonLinesIngestSource;
+
+#ifdef __linux__
+static int	inotify_fd = -1;
+#endif
+
+/*
+ * Define the GUC parameters and register the worker.  This does nothing
+ * unless the library is loaded by shared_preload_libraries.
+ */
+void
+RegisterJsonLinesIngestWorker(void)
+{
+	BackgroundWorker worker;
+
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	DefineCustomStringVariable("pg_custom_copy_formats.ingest_database",
+							   "Database the jsonlines ingest worker connects to.",
+							   "The worker is not started if this is not set.",
+							   &ingest_database,
+							   NULL,
+							   PGC_POSTMASTER,
+							   0,
+							   NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pg_custom_copy_formats.ingest_naptime",
+							"Interval between the scans of the jsonlines ingest sources.",
+							"On Linux, the worker also wakes up when the sources change.",
+							&ingest_naptime,
+							5000,
+							10,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_UNIT_MS,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pg_custom_copy_formats.ingest_batch_size",
+							"Amount of data loaded by the jsonlines ingest worker per transaction.",
+							NULL,
+							&ingest_batch_size,
+							8192,
+							1,
+							MAX_KILOBYTES,
+							PGC_SIGHUP,
+							GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	MarkGUCPrefixReserved("pg_custom_copy_formats");
+
+	if (ingest_database == NULL || ingest_database[0] == '\0')
+		return;
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+		BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	worker.bgw_restart_time = 10;
+	snprintf(worker.bgw_library_name, MAXPGPATH, "pg_custom_copy_formats");
+	snprintf(worker.bgw_function_name, BGW_MAXLEN, "jsonlines_ingest_main");
+	snprintf(worker.bgw_name, BGW_MAXLEN, "jsonlines ingest worker");
+	snprintf(worker.bgw_type, BGW_MAXLEN, "jsonlines ingest worker");
+	worker.bgw_main_arg = (Datum) 0;
+
+	RegisterBackgroundWorker(&worker);
+}
+
+/*
+ * Data source callback of COPY, feeding the current range of the file.
+ */
+static int
+ingest_read_data(void *outbuf, int minread, int maxread)
+{
+	JsonLinesIngestRange *range = current_range;
+	int			nread;
+
+	Assert(range != NULL);
+
+	if (range->pos >= range->end)
+		return 0;
+
+	nread = pg_pread(range->fd, outbuf, Min(maxread, range->end - range->pos),
+					 range->pos);
+	if (nread < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", range->path)));
+
+	range->pos += nread;
+
+	return nread;
+}
+
+/*
+ * Return the end of the next batch starting at 'start': the position after
+ * the first newline at or after start + batch size, or after the last
+ * newline before the end of the file.  Returns 'start' if there is no
+ * complete line.
+ */
+static off_t
+ingest_find_batch_end(int fd, const char *path, off_t start)
+{
+	char		buf[BLCKSZ];
+	off_t		pos = start;
+	off_t		end = start;
+	off_t		limit = start + (off_t) ingest_batch_size * 1024;
+
+	for (;;)
+	{
+		int			nread;
+
+		nread = pg_pread(fd, buf, sizeof(buf), pos);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		if (nread == 0)
+			break;
+
+		for (int i = nread - 1; i >= 0; i--)
+		{
+			if (buf[i] == '\n')
+			{
+				end = pos + i + 1;
+				break;
+			}
+		}
+
+		pos += nread;
+
+		/* Stop at a line boundary once the batch is large enough */
+		if (end >= limit || (pos >= limit && end > start))
+			break;
+	}
+
+	return end;
+}
+
+/*
+ * Load the given range of the file, or the whole file if it's compressed,
+ * into the target table.  Returns the number of rows loaded.
+ */
+static uint64
+ingest_load(Relation rel, const char *path, bool compressed, int fd,
+			off_t start, off_t end)
+{
+	ParseState *pstate;
+	ParseNamespaceItem *nsitem;
+	CopyFromState cstate;
+	JsonLinesIngestRange range;
+	List	   *options;
+	uint64		processed;
+
+	/* Set up the range table for CopyFrom(), like DoCopy() */
+	pstate = make_parsestate(NULL);
+	nsitem = addRangeTableEntryForRelation(pstate, rel, RowExclusiveLock,
+										   NULL, false, false);
+	nsitem->p_perminfo->requiredPerms = ACL_INSERT;
+
+	options = list_make1(makeDefElem("format",
+									 (Node *) makeString("jsonlines"), -1));
+
+	range.path = path;
+	range.fd = fd;
+	range.pos = start;
+	range.end = end;
+
+	if (compressed)
+		cstate = BeginCopyFrom(pstate, rel, NULL, path, false, NULL, NIL,
+							   options);
+	else
+		cstate = BeginCopyFrom(pstate, rel, NULL, NULL, false,
+							   ingest_read_data, NIL, options);
+
+	current_range = &range;
+	processed = CopyFrom(cstate);
+	current_range = NULL;
+
+	EndCopyFrom(cstate);
+	free_parsestate(pstate);
+
+	return processed;
+}
+
+/*
+ * Look up the loaded offset of the file, and the device and inode numbers of
+ * the file it was loaded from.  *file_dev and *file_ino are left alone if they
+ * were not recorded.  Returns false if the file has not been seen yet.
+ */
+static bool
+ingest_get_state(const char *schema, const char *file_path, off_t *offset,
+				 bool *done, int64 *file_dev, int64 *file_ino)
+{
+	Oid			argtypes[1] = {TEXTOID};
+	Datum		args[1];
+	char	   *sql;
+	bool		isnull;
+	Datum		value;
+	int			ret;
+
+	sql = psprintf("SELECT read_offset, done, file_dev, file_ino "
+				   "FROM %s.jsonlines_ingest_files WHERE file_path = $1",
+				   quote_identifier(schema));
+	args[0] = CStringGetTextDatum(file_path);
+
+	ret = SPI_execute_with_args(sql, 1, argtypes, args, NULL, true, 1);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "SPI_execute_with_args failed: error code %d", ret);
+
+	if (SPI_processed == 0)
+		return false;
+
+	*offset = DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[0],
+										  SPI_tuptable->tupdesc, 1, &isnull));
+	*done = DatumGetBool(SPI_getbinval(SPI_tuptable->vals[0],
+									   SPI_tuptable->tupdesc, 2, &isnull));
+
+	value = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 3,
+						  &isnull);
+	if (!isnull)
+		*file_dev = DatumGetInt64(value);
+	value = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 4,
+						  &isnull);
+	if (!isnull)
+		*file_ino = DatumGetInt64(value);
+
+	return true;
+}
+
+/*
+ * Record the loaded offset of the file, the device and inode numbers of the
+ * file, and the error if the last batch failed to load.
+ */
+static void
+ingest_set_state(const char *schema, const char *source_path,
+				 const char *file_path, const struct stat *st, off_t offset,
+				 bool done, const char *error)
+{
+	Oid			argtypes[7] = {TEXTOID, TEXTOID, INT8OID, BOOLOID, TEXTOID,
+	INT8OID, INT8OID};
+	Datum		args[7];
+	char		nulls[7] = {' ', ' ', ' ', ' ', ' ', ' ', ' '};
+	char	   *sql;
+	int			ret;
+
+	sql = psprintf("INSERT INTO %s.jsonlines_ingest_files "
+				   "(file_path, source_path, read_offset, done, error, "
+				   "file_dev, file_ino) "
+				   "VALUES ($1, $2, $3, $4, $5, $6, $7) "
+				   "ON CONFLICT (file_path) DO UPDATE "
+				   "SET read_offset = EXCLUDED.read_offset, done = EXCLUDED.done, "
+				   "error = EXCLUDED.error, file_dev = EXCLUDED.file_dev, "
+				   "file_ino = EXCLUDED.file_ino, updated_at = now()",
+				   quote_identifier(schema));
+	args[0] = CStringGetTextDatum(file_path);
+	args[1] = CStringGetTextDatum(source_path);
+	args[2] = Int64GetDatum(offset);
+	args[3] = BoolGetDatum(done);
+	if (error != NULL)
+		args[4] = CStringGetTextDatum(error);
+	else
+	{
+		args[4] = (Datum) 0;
+		nulls[4] = 'n';
+	}
+	args[5] = Int64GetDatum((int64) st->st_dev);
+	args[6] = Int64GetDatum((int64) st->st_ino);
+
+	ret = SPI_execute_with_args(sql, 7, argtypes, args, nulls, false, 0);
+	if (ret != SPI_OK_INSERT)
+		elog(ERROR, "SPI_execute_with_args failed: error code %d", ret);
+}
+
+/*
+ * Return the schema of the extension, or NULL if it's not installed in the
+ * database.  Must be called in a transaction.
+ */
+static char *
+ingest_get_schema(void)
+{
+	Oid			extoid = get_extension_oid("pg_custom_copy_formats", true);
+
+	if (!OidIsValid(extoid))
+		return NULL;
+
+	return get_namespace_name(get_extension_schema(extoid));
+}
+
+/*
+ * Load the range of the file into the target table in a subtransaction.
+ * Returns the error message if it failed, or NULL.
+ */
+static char *
+ingest_load_guarded(JsonLinesIngestSource *source, const char *file_path,
+					bool compressed, int fd, off_t start, off_t end,
+					uint64 *processed)
+{
+	MemoryContext oldcxt = CurrentMemoryContext;
+	ResourceOwner oldowner = CurrentResourceOwner;
+	char	   *error = NULL;
+
+	BeginInternalSubTransaction(NULL);
+	MemoryContextSwitchTo(oldcxt);
+
+	PG_TRY();
+	{
+		Relation	rel = table_open(source->target, RowExclusiveLock);
+
+		*processed = ingest_load(rel, file_path, compressed, fd, start, end);
+		table_close(rel, NoLock);
+
+		ReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldcxt);
+		CurrentResourceOwner = oldowner;
+	}
+	PG_CATCH();
+	{
+		ErrorData  *edata;
+
+		current_range = NULL;
+
+		MemoryContextSwitchTo(oldcxt);
+		edata = CopyErrorData();
+		FlushErrorState();
+
+		RollbackAndReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldcxt);
+		CurrentResourceOwner = oldowner;
+
+		error = edata->message;
+	}
+	PG_END_TRY();
+
+	return error;
+}
+
+/*
+ * Load one batch of the file in the current transaction.  Returns true if
+ * there may be more to load.
+ */
+static bool
+ingest_file_batch_internal(const char *schema, JsonLinesIngestSource *source,
+						   const char *file_path)
+{
+	bool		compressed;
+	off_t		offset = 0;
+	off_t		end;
+	bool		done = false;
+	int64		file_dev = -1;
+	int64		file_ino = -1;
+	bool		more = false;
+	int			fd;
+	struct stat st;
+
+	(void) ingest_get_state(schema, file_path, &offset, &done, &file_dev,
+							&file_ino);
+
+	fd = OpenTransientFile(file_path, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		/* The file may have been moved away since we listed it */
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\" for reading: %m",
+							file_path)));
+		return false;
+	}
+
+	if (fstat(fd, &st) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", file_path)));
+
+	/*
+	 * A rotated file may have been replaced by a new file at the same path,
+	 * and the new file may already be longer than the loaded offset.
+	 */
+	if (file_ino != -1 &&
+		(file_dev != (int64) st.st_dev || file_ino != (int64) st.st_ino))
+	{
+		ereport(LOG,
+				(errmsg("file \"%s\" was replaced, loading it from the start",
+						file_path)));
+		offset = 0;
+		done = false;
+	}
+
+	if (done)
+	{
+		CloseTransientFile(fd);
+		return false;
+	}
+
+	if (st.st_size < offset)
+	{
+		ereport(LOG,
+				(errmsg("file \"%s\" was truncated, loading it from the start",
+						file_path)));
+		offset = 0;
+	}
+
+	compressed = CopyInputDetectCompression(file_path) != PG_COMPRESSION_NONE;
+	end = compressed ? st.st_size : ingest_find_batch_end(fd, file_path, offset);
+
+	if (end > offset)
+	{
+		uint64		processed = 0;
+		char	   *error;
+
+		error = ingest_load_guarded(source, file_path, compressed, fd, offset,
+									end, &processed);
+		if (error != NULL)
+		{
+			/* Keep the offset of the failed batch, and skip the file */
+			ereport(LOG,
+					(errmsg("could not load file \"%s\" at offset %lld, skipping it",
+							file_path, (long long) offset),
+					 errdetail_internal("%s", error)));
+			ingest_set_state(schema, source->path, file_path, &st, offset,
+							 true, error);
+		}
+		else
+		{
+			ingest_set_state(schema, source->path, file_path, &st, end,
+							 compressed, NULL);
+
+			elog(DEBUG1, "loaded %" PRIu64 " rows from \"%s\" into \"%s\"",
+				 processed, file_path, get_rel_name(source->target));
+
+			more = !compressed;
+		}
+	}
+
+	CloseTransientFile(fd);
+
+	return more;
+}
+
+/*
+ * Load one batch of the file in its own transaction.  Returns true if there
+ * may be more to load.
+ */
+static bool
+ingest_file_batch(JsonLinesIngestSource *source, const char *file_path)
+{
+	char	   *schema;
+	bool		more = false;
+
+	StartTransactionCommand();
+	SPI_connect();
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	schema = ingest_get_schema();
+	if (schema != NULL)
+	{
+		pgstat_report_activity(STATE_RUNNING, file_path);
+		more = ingest_file_batch_internal(schema, source, file_path);
+	}
+
+	SPI_finish();
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	return more;
+}
+
+/*
+ * jsonlines_ingest_batch(source_path text, file_path text) returns bool
+ *
+ * Load one batch of a file of the source in the current transaction, like
+ * the worker does.  Returns true if there may be more to load.
+ */
+Datum
+jsonlines_ingest_batch(PG_FUNCTION_ARGS)
+{
+	JsonLinesIngestSource source;
+	char	   *file_path = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	char	   *schema;
+	Oid			argtypes[1] = {TEXTOID};
+	Datum		args[1];
+	char	   *sql;
+	bool		isnull;
+	bool		more;
+	int			ret;
+
+	source.path = text_to_cstring(PG_GETARG_TEXT_PP(0));
+
+	SPI_connect();
+
+	schema = ingest_get_schema();
+	if (schema == NULL)
+		elog(ERROR, "extension \"pg_custom_copy_formats\" is not installed");
+
+	sql = psprintf("SELECT target::oid FROM %s.jsonlines_ingest_sources "
+				   "WHERE source_path = $1",
+				   quote_identifier(schema));
+	args[0] = CStringGetTextDatum(source.path);
+
+	ret = SPI_execute_with_args(sql, 1, argtypes, args, NULL, true, 1);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "SPI_execute_with_args failed: error code %d", ret);
+
+	if (SPI_processed == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("jsonlines ingest source \"%s\" does not exist",
+						source.path)));
+
+	source.target = DatumGetObjectId(SPI_getbinval(SPI_tuptable->vals[0],
+												   SPI_tuptable->tupdesc, 1,
+												   &isnull));
+
+	more = ingest_file_batch_internal(schema, &source, file_path);
+
+	SPI_finish();
+
+	PG_RETURN_BOOL(more);
+}
+
+static int
+compare_paths(const ListCell *a, const ListCell *b)
+{
+	return strcmp((const char *) lfirst(a), (const char *) lfirst(b));
+}
+
+/*
+ * Return the files of the source: the files in the directory in name order,
+ * or the file itself.
+ */
+static List *
+ingest_list_files(JsonLinesIngestSource *source)
+{
+	struct stat st;
+	List	   *files = NIL;
+	DIR		   *dir;
+	struct dirent *de;
+
+	if (stat(source->path, &st) < 0)
+		return NIL;
+
+	if (!S_ISDIR(st.st_mode))
+		return list_make1(pstrdup(source->path));
+
+	dir = AllocateDir(source->path);
+	while ((de = ReadDirExtended(dir, source->path, LOG)) != NULL)
+	{
+		char	   *path;
+
+		/* Skip hidden files, e.g. ones still being written by a spooler */
+		if (de->d_name[0] == '.')
+			continue;
+
+		path = psprintf("%s/%s", source->path, de->d_name);
+		if (get_dirent_type(path, de, false, LOG) != PGFILETYPE_REG)
+			continue;
+
+		files = lappend(files, path);
+	}
+	FreeDir(dir);
+
+	list_sort(files, compare_paths);
+
+	return files;
+}
+
+/*
+ * Read the configured sources.
+ */
+static List *
+ingest_get_sources(MemoryContext cxt)
+{
+	List	   *sources = NIL;
+	char	   *schema;
+
+	StartTransactionCommand();
+	SPI_connect();
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	schema = ingest_get_schema();
+	if (schema != NULL)
+	{
+		char	   *sql;
+		int			ret;
+
+		sql = psprintf("SELECT source_path, target::oid FROM %s.jsonlines_ingest_sources "
+					   "ORDER BY source_path",
+					   quote_identifier(schema));
+		ret = SPI_execute(sql, true, 0);
+		if (ret != SPI_OK_SELECT)
+			elog(ERROR, "SPI_execute failed: error code %d", ret);
+
+		for (uint64 i = 0; i < SPI_processed; i++)
+		{
+			HeapTuple	tuple = SPI_tuptable->vals[i];
+			TupleDesc	tupdesc = SPI_tuptable->tupdesc;
+			MemoryContext oldcxt = MemoryContextSwitchTo(cxt);
+			JsonLinesIngestSource *source = palloc(sizeof(JsonLinesIngestSource));
+			bool		isnull;
+
+			source->path = SPI_getvalue(tuple, tupdesc, 1);
+			source->target = DatumGetObjectId(SPI_getbinval(tuple, tupdesc, 2,
+															&isnull));
+			sources = lappend(sources, source);
+
+			MemoryContextSwitchTo(oldcxt);
+		}
+	}
+
+	SPI_finish();
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	return sources;
+}
+
+/*
+ * Load the new data of all the sources.
+ */
+static void
+ingest_scan(MemoryContext cxt)
+{
+	List	   *sources = ingest_get_sources(cxt);
+	MemoryContext oldcxt = MemoryContextSwitchTo(cxt);
+
+	foreach_ptr(JsonLinesIngestSource, source, sources)
+	{
+#ifdef __linux__
+		if (inotify_fd >= 0 &&
+			inotify_add_watch(inotify_fd, source->path,
+							  IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE |
+							  IN_MOVED_TO) < 0 &&
+			errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not watch \"%s\": %m", source->path)));
+#endif
+
+		foreach_ptr(char, file_path, ingest_list_files(source))
+		{
+			while (ingest_file_batch(source, file_path))
+			{
+				CHECK_FOR_INTERRUPTS();
+				if (ConfigReloadPending)
+				{
+					ConfigReloadPending = false;
+					ProcessConfigFile(PGC_SIGHUP);
+				}
+			}
+		}
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+void
+jsonlines_ingest_main(Datum main_arg)
+{
+	MemoryContext scancxt;
+
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnection(ingest_database, NULL, 0);
+
+	ingest_wait_event_main = WaitEventExtensionNew("JsonLinesIngestMain");
+
+#ifdef __linux__
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0)
+		ereport(LOG,
+				(errmsg("could not initialize inotify, polling the jsonlines ingest sources: %m")));
+#endif
+
+	scancxt = AllocSetContextCreate(TopMemoryContext,
+									"jsonlines ingest scan",
+									ALLOCSET_DEFAULT_SIZES);
+
+	for (;;)
+	{
+		int			events = WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH;
+		pgsocket	sock = PGINVALID_SOCKET;
+		int			rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		ingest_scan(scancxt);
+		MemoryContextReset(scancxt);
+
+#ifdef __linux__
+		if (inotify_fd >= 0)
+		{
+			events |= WL_SOCKET_READABLE;
+			sock = inotify_fd;
+		}
+#endif
+
+		rc = WaitLatchOrSocket(MyLatch, events, sock, ingest_naptime,
+							   ingest_wait_event_main);
+
+		if (rc & WL_LATCH_SET)
+			ResetLatch(MyLatch);
+
+#ifdef __linux__
+		/* We rescan all the sources, so just drain the events */
+		if (rc & WL_SOCKET_READABLE)
+		{
+			char		buf[4096];
+
+			while (read(inotify_fd, buf, sizeof(buf)) > 0)
+				;
+		}
+#endif
+	}
+}
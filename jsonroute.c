@@ -0,0 +1,234 @@
+/*--------------------------------------------------------------------------
+ *
+ * jsonroute.c
+ *		Routing of jsonlines rows to several tables by a discriminator key.
+ *
+ * With the 'route_key' and 'routes' options, COPY FROM with the jsonlines
+ * format sends each document to the table mapped to the value of its route
+ * key, e.g.
+ *
+ *	route_key 'type', routes 'click=clicks, view=page_views'
+ *
+ * Documents whose route key matches none of the routes go to the target
+ * table of COPY as usual.
+ *
+ * Each route has its own decoder, and the decoded rows are inserted into
+ * the route table through sidetable.c.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		jsonroute.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+#include "pg_custom_copy_formats.h"
+
+/*
+ * A route table.
+ */
+typedef struct JsonLinesRoute
+{
+	CopySideTable *table;
+	JsonLinesRowDecoder *decoder;
+} JsonLinesRoute;
+
+struct JsonLinesRouter
+{
+	char	   *route_key;
+	int			route_keylen;
+	CopyKeyMap *map;			/* route key value -> index + 1 */
+	int			nroutes;
+	JsonLinesRoute *routes;
+};
+
+/*
+ * Open the route table and create the decoder of its columns.
+ */
+static void
+route_open(JsonLinesRoute *route, const char *tablename)
+{
+	TupleDesc	tupdesc;
+	List	   *attnumlist = NIL;
+
+	route->table = CopySideTableOpen(tablename, "route table");
+	tupdesc = RelationGetDescr(route->table->rel);
+
+	/* Generated columns are computed rather than decoded */
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (att->attisdropped || att->attgenerated)
+			continue;
+		attnumlist = lappend_int(attnumlist, i + 1);
+	}
+	route->decoder = JsonLinesCreateRowDecoder(tupdesc, attnumlist, NULL, NULL,
+											   NULL, NULL);
+}
+
+/*
+ * Decode the document into the next row of the route table.
+ */
+static void
+route_add(JsonLinesRoute *route, Jsonb *jb)
+{
+	CopySideTable *table = route->table;
+	TupleDesc	tupdesc = RelationGetDescr(table->rel);
+	TupleTableSlot *slot = CopySideTableNextSlot(table);
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(table->context);
+
+	/* columns that are not decoded are NULL */
+	memset(slot->tts_isnull, true, sizeof(bool) * tupdesc->natts);
+	JsonLinesDecodeRow(route->decoder, jb, slot->tts_values, slot->tts_isnull,
+					   NULL);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	CopySideTableInsert(table, slot);
+}
+
+/*
+ * Create a router from the 'route_key' and 'routes' options.  'routes' is a
+ * comma-separated list of value=table entries.
+ */
+JsonLinesRouter *
+JsonLinesCreateRouter(char *route_key, char *routes)
+{
+	JsonLinesRouter *router = palloc0(sizeof(JsonLinesRouter));
+	List	   *entries = NIL;
+	char	   *p = pstrdup(routes);
+	int			i = 0;
+
+	router->route_key = route_key;
+	router->route_keylen = strlen(route_key);
+
+	while (*p != '\0')
+	{
+		char	   *entry;
+		char	   *comma;
+
+		while (*p == ' ' || *p == ',')
+			p++;
+		if (*p == '\0')
+			break;
+
+		entry = p;
+		comma = strchr(p, ',');
+		if (comma != NULL)
+		{
+			*comma = '\0';
+			p = comma + 1;
+		}
+		else
+			p += strlen(p);
+
+		entries = lappend(entries, entry);
+	}
+
+	if (entries == NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("routes must have at least one entry")));
+
+	router->nroutes = list_length(entries);
+	router->routes = palloc0(sizeof(JsonLinesRoute) * router->nroutes);
+	router->map = CopyKeyMapCreate(router->nroutes);
+
+	foreach_ptr(char, entry, entries)
+	{
+		char	   *eq = strchr(entry, '=');
+		char	   *value;
+		char	   *end;
+
+		if (eq == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid routes entry: \"%s\"", entry),
+					 errhint("Entries must have the form value=table.")));
+
+		/* value, with trailing spaces trimmed */
+		value = entry;
+		end = eq;
+		while (end > value && end[-1] == ' ')
+			end--;
+		*end = '\0';
+
+		if (CopyKeyMapLookup(router->map, value, strlen(value)) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("route value \"%s\" appears more than once in routes",
+							value)));
+
+		CopyKeyMapInsert(router->map, value, strlen(value), i + 1);
+		route_open(&router->routes[i], eq + 1);
+		i++;
+	}
+
+	return router;
+}
+
+/*
+ * Send the document to the table of its route.  Returns false if the route
+ * key is missing or matches no route, in which case the caller loads the
+ * document into the target table of COPY.
+ */
+bool
+JsonLinesRouteRow(JsonLinesRouter *router, Jsonb *jb)
+{
+	JsonbValue	vbuf;
+	JsonbValue *v;
+	int			idx;
+
+	if (!JB_ROOT_IS_OBJECT(jb))
+		return false;
+
+	v = getKeyJsonValueFromContainer(&jb->root, router->route_key,
+									 router->route_keylen, &vbuf);
+	if (v == NULL || v->type != jbvString)
+		return false;
+
+	idx = CopyKeyMapLookup(router->map, v->val.string.val, v->val.string.len);
+	if (idx == 0)
+		return false;
+
+	route_add(&router->routes[idx - 1], jb);
+
+	return true;
+}
+
+/*
+ * Write out the buffered rows and close the route tables, reporting the
+ * number of rows loaded into each.  Returns the total number of rows loaded
+ * into them.
+ */
+uint64
+JsonLinesFinishRouter(JsonLinesRouter *router)
+{
+	uint64		processed = 0;
+
+	for (int i = 0; i < router->nroutes; i++)
+	{
+		CopySideTable *table = router->routes[i].table;
+		char	   *relname = pstrdup(RelationGetRelationName(table->rel));
+		uint64		nrows = CopySideTableClose(table);
+
+		ereport(NOTICE,
+				(errmsg_plural("%" PRIu64 " row was loaded into table \"%s\"",
+							   "%" PRIu64 " rows were loaded into table \"%s\"",
+							   nrows,
+							   nrows,
+							   relname)));
+		processed += nrows;
+	}
+
+	return processed;
+}
@@ -0,0 +1,136 @@
+/*--------------------------------------------------------------------------
+ *
+ * keymap.c
+ *		Key to attribute number lookup table for the key-value based formats.
+ *
+ * Formats that identify values by key (e.g. line protocol tags and fields)
+ * build this table once at the start of COPY, so that each key in the input
+ * is resolved with a single hash probe instead of comparing it against every
+ * column name.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		keymap.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/tupdesc.h"
+#include "common/hashfn.h"
+#include "nodes/pg_list.h"
+#include "utils/elog.h"
+
+#include "pg_custom_copy_formats.h"
+
+/*
+ * Create an empty map that can hold up to 'nkeys' keys.
+ */
+CopyKeyMap *
+CopyKeyMapCreate(int nkeys)
+{
+	CopyKeyMap *map = palloc(sizeof(CopyKeyMap));
+	int			size = 8;
+
+	/* Keep the load factor at or below 0.5 */
+	while (size < nkeys * 2)
+		size <<= 1;
+
+	map->size = size;
+	map->nkeys = 0;
+	map->entries = palloc0(sizeof(CopyKeyMapEntry) * size);
+
+	return map;
+}
+
+/*
+ * Add a key.  The key string must outlive the map.  If the key is already
+ * present, its value is replaced.
+ */
+void
+CopyKeyMapInsert(CopyKeyMap *map, const char *key, int keylen, int value)
+{
+	uint32		hash = hash_bytes((const unsigned char *) key, keylen);
+	uint32		mask = map->size - 1;
+	uint32		i;
+
+	Assert(value != 0);
+
+	for (i = hash & mask;; i = (i + 1) & mask)
+	{
+		CopyKeyMapEntry *entry = &map->entries[i];
+
+		if (entry->value == 0)
+		{
+			if (map->nkeys * 2 >= map->size)
+				elog(ERROR, "too many keys in key map");
+
+			entry->key = key;
+			entry->keylen = keylen;
+			entry->hash = hash;
+			entry->value = value;
+			map->nkeys++;
+			return;
+		}
+
+		if (entry->hash == hash && entry->keylen == keylen &&
+			memcmp(entry->key, key, keylen) == 0)
+		{
+			entry->value = value;
+			return;
+		}
+	}
+}
+
+/*
+ * Build a map from the names of the given columns to their attribute numbers.
+ * Columns listed in 'exclude' are left out.
+ */
+CopyKeyMap *
+CopyKeyMapFromColumns(TupleDesc tupdesc, List *attnumlist, List *exclude)
+{
+	CopyKeyMap *map = CopyKeyMapCreate(list_length(attnumlist));
+	ListCell   *lc;
+
+	foreach(lc, attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		char	   *attname;
+
+		if (list_member_int(exclude, attnum))
+			continue;
+
+		attname = NameStr(TupleDescAttr(tupdesc, attnum - 1)->attname);
+		CopyKeyMapInsert(map, attname, strlen(attname), attnum);
+	}
+
+	return map;
+}
+
+/*
+ * Return the attribute number of the named column if it's in 'attnumlist',
+ * or 0.  If 'required', raise an error instead of returning 0.
+ */
+int
+CopyFindColumn(List *attnumlist, TupleDesc tupdesc, const char *name,
+			   bool required)
+{
+	ListCell   *lc;
+
+	foreach(lc, attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+
+		if (strcmp(NameStr(TupleDescAttr(tupdesc, attnum - 1)->attname), name) == 0)
+			return attnum;
+	}
+
+	if (required)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("column \"%s\" is not copied", name)));
+
+	return 0;
+}
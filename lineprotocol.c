@@ -0,0 +1,736 @@
+/*--------------------------------------------------------------------------
+ *
+ * lineprotocol.c
+ *		InfluxDB line protocol support for COPY FROM command.
+ *
+ * Each line has the form
+ *
+ *	measurement[,tag=value...] field=value[,field=value...] [timestamp]
+ *
+ * The measurement goes to the 'measurement_column' (default "measurement"),
+ * the timestamp to the 'time_column' (default "time"), and tags and fields
+ * to the columns of the same name.  Tags and fields that match no column
+ * are collected into the jsonb 'extra_keys_column' if given, and dropped
+ * otherwise.
+ *
+ * The line is parsed in place: escape sequences are removed by shifting the
+ * remaining bytes down and every token is terminated by overwriting the byte
+ * that follows it, so no intermediate copies are made.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		lineprotocol.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "commands/copyapi.h"
+#include "commands/copystate.h"
+#include "commands/defrem.h"
+#include "common/int.h"
+#include "datatype/timestamp.h"
+#include "port/simd.h"
+#include "utils/builtins.h"
+#include "utils/jsonb.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+
+#include "pg_custom_copy_formats.h"
+
+/*
+ * Struct for COPY options for lineprotocol format.
+ */
+typedef struct LineProtocolOptions
+{
+	char	   *measurement_column;
+	char	   *time_column;
+	char	   *extra_keys_column;
+	int64		precision;		/* nanoseconds per timestamp unit */
+} LineProtocolOptions;
+
+typedef struct CopyFromStateLineProtocol
+{
+	CopyFromStateData base;
+
+	LineProtocolOptions options;
+
+	/* Attribute numbers of the special columns, or 0 if not copied */
+	int			measurement_attnum;
+	int			time_attnum;
+	int			extra_attnum;
+	Oid			time_typid;
+
+	/* Tag and field names to attribute numbers */
+	CopyKeyMap *keymap;
+
+	/* Input pipeline shared with the other text-based formats */
+	CopyInputBuffer input;
+} CopyFromStateLineProtocol;
+
+/* Type of a field value */
+typedef enum LpValueType
+{
+	LP_VALUE_TAG,
+	LP_VALUE_FLOAT,
+	LP_VALUE_INTEGER,
+	LP_VALUE_STRING,
+	LP_VALUE_BOOLEAN,
+} LpValueType;
+
+static void
+lineprotocol_syntax_error(CopyFromStateLineProtocol *cstate, const char *msg)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+			 errmsg("invalid line protocol data: %s", msg),
+			 errdetail("Line " UINT64_FORMAT ": \"%s\"",
+					   cstate->base.cur_lineno,
+					   cstate->input.line_buf.data)));
+}
+
+/*
+ * Return the first byte in [p, end) that is one of ',', ' ', '=' or '\\'.
+ * Returns 'end' if there is none.
+ */
+static inline char *
+lp_scan_key(char *p, char *end)
+{
+#ifndef USE_NO_SIMD
+	while (p + sizeof(Vector8) <= end)
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) p);
+		if (vector8_has(chunk, ',') || vector8_has(chunk, ' ') ||
+			vector8_has(chunk, '=') || vector8_has(chunk, '\\'))
+			break;
+		p += sizeof(Vector8);
+	}
+#endif
+
+	while (p < end && *p != ',' && *p != ' ' && *p != '=' && *p != '\\')
+		p++;
+
+	return p;
+}
+
+/*
+ * Return the first byte in [p, end) that is '"' or '\\'.  Returns 'end' if
+ * there is none.
+ */
+static inline char *
+lp_scan_string(char *p, char *end)
+{
+#ifndef USE_NO_SIMD
+	while (p + sizeof(Vector8) <= end)
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) p);
+		if (vector8_has(chunk, '"') || vector8_has(chunk, '\\'))
+			break;
+		p += sizeof(Vector8);
+	}
+#endif
+
+	while (p < end && *p != '"' && *p != '\\')
+		p++;
+
+	return p;
+}
+
+/*
+ * Parse a measurement name, tag key, tag value or field key starting at *rp.
+ * Backslash escapes are removed in place.  Stops at an unescaped ',', ' ' or,
+ * if 'stop_at_eq', '='.  The token is NUL-terminated, *rp is set to the
+ * delimiter position and the delimiter is returned ('\0' at the end of line).
+ */
+static char
+lp_parse_token(char **rp, char *end, bool stop_at_eq, char **token, int *len)
+{
+	char	   *r = *rp;
+	char	   *w = r;
+	char		delim = '\0';
+
+	*token = r;
+
+	while (r < end)
+	{
+		char	   *next = lp_scan_key(r, end);
+		int			n = next - r;
+
+		if (w != r)
+			memmove(w, r, n);
+		w += n;
+		r = next;
+
+		if (r >= end)
+			break;
+
+		if (*r == '\\' && r + 1 < end)
+		{
+			/* keep the escaped byte */
+			*w++ = r[1];
+			r += 2;
+			continue;
+		}
+
+		if (*r == '=' && !stop_at_eq)
+		{
+			*w++ = *r++;
+			continue;
+		}
+
+		if (*r == '\\')
+		{
+			/* trailing backslash */
+			*w++ = *r++;
+			continue;
+		}
+
+		delim = *r;
+		break;
+	}
+
+	*len = w - *token;
+	*rp = r;
+	*w = '\0';
+
+	return delim;
+}
+
+/*
+ * Parse a field value starting at *rp.  String values are unquoted and
+ * unescaped in place; the 'i' and 'u' suffixes of integers are removed.
+ */
+static char
+lp_parse_field_value(CopyFromStateLineProtocol *cstate, char **rp, char *end,
+					 char **value, int *len, LpValueType *type)
+{
+	char	   *r = *rp;
+	char		delim;
+
+	if (r < end && *r == '"')
+	{
+		char	   *w = ++r;
+
+		*value = w;
+
+		for (;;)
+		{
+			char	   *next = lp_scan_string(r, end);
+			int			n = next - r;
+
+			if (w != r)
+				memmove(w, r, n);
+			w += n;
+			r = next;
+
+			if (r >= end)
+				lineprotocol_syntax_error(cstate, "unterminated string field value");
+
+			if (*r == '\\' && r + 1 < end && (r[1] == '"' || r[1] == '\\'))
+			{
+				*w++ = r[1];
+				r += 2;
+				continue;
+			}
+
+			if (*r == '\\')
+			{
+				*w++ = *r++;
+				continue;
+			}
+
+			/* closing quote */
+			r++;
+			break;
+		}
+
+		delim = (r < end) ? *r : '\0';
+		if (delim != '\0' && delim != ',' && delim != ' ')
+			lineprotocol_syntax_error(cstate, "unexpected character after string field value");
+
+		*len = w - *value;
+		*w = '\0';
+		*rp = r;
+		*type = LP_VALUE_STRING;
+
+		return delim;
+	}
+
+	delim = lp_parse_token(&r, end, false, value, len);
+	*rp = r;
+
+	if (*len == 0)
+		lineprotocol_syntax_error(cstate, "missing field value");
+
+	switch ((*value)[*len - 1])
+	{
+		case 'i':
+		case 'u':
+			(*value)[--(*len)] = '\0';
+			*type = LP_VALUE_INTEGER;
+			break;
+		case 't':
+		case 'T':
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+			/* t, T, true, True, TRUE, f, F, false, False, FALSE */
+			if ((*value)[0] == 't' || (*value)[0] == 'T' ||
+				(*value)[0] == 'f' || (*value)[0] == 'F')
+			{
+				*type = LP_VALUE_BOOLEAN;
+				break;
+			}
+			/* FALLTHROUGH */
+		default:
+			*type = LP_VALUE_FLOAT;
+			break;
+	}
+
+	return delim;
+}
+
+/*
+ * Add a key/value pair that matches no column to the extra keys object.
+ */
+static void
+lp_push_extra(JsonbParseState **state, char *key, int keylen, char *value,
+			  int len, LpValueType type)
+{
+	JsonbValue	jbv;
+
+	jbv.type = jbvString;
+	jbv.val.string.val = key;
+	jbv.val.string.len = keylen;
+	(void) pushJsonbValue(state, WJB_KEY, &jbv);
+
+	switch (type)
+	{
+		case LP_VALUE_TAG:
+		case LP_VALUE_STRING:
+			jbv.type = jbvString;
+			jbv.val.string.val = value;
+			jbv.val.string.len = len;
+			break;
+		case LP_VALUE_BOOLEAN:
+			jbv.type = jbvBool;
+			jbv.val.boolean = (value[0] == 't' || value[0] == 'T');
+			break;
+		case LP_VALUE_INTEGER:
+		case LP_VALUE_FLOAT:
+			jbv.type = jbvNumeric;
+			jbv.val.numeric = DatumGetNumeric(DirectFunctionCall3(numeric_in,
+																  CStringGetDatum(value),
+																  ObjectIdGetDatum(InvalidOid),
+																  Int32GetDatum(-1)));
+			break;
+	}
+
+	(void) pushJsonbValue(state, WJB_VALUE, &jbv);
+}
+
+/*
+ * Convert the value into the column.  Returns false if the row is skipped
+ * after a soft error.
+ */
+static bool
+lp_set_column(CopyFromStateLineProtocol *cstate, int attnum, char *value,
+			  Datum *values, bool *nulls)
+{
+	int			m = attnum - 1;
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(cstate->base.rel), m);
+
+	if (!InputFunctionCallSafe(&cstate->base.in_functions[m],
+							   value,
+							   cstate->base.typioparams[m],
+							   att->atttypmod,
+							   (Node *) cstate->base.escontext,
+							   &values[m]))
+	{
+		CopyInputSkipRow((CopyFromState) cstate, NameStr(att->attname));
+		return false;
+	}
+
+	nulls[m] = false;
+
+	return true;
+}
+
+/*
+ * Set the timestamp column from the integer timestamp of the line.  Returns
+ * false if the row is skipped after a soft error.
+ */
+static bool
+lp_set_time(CopyFromStateLineProtocol *cstate, char *value, Datum *values,
+			bool *nulls)
+{
+	int			m = cstate->time_attnum - 1;
+	int64		ts;
+	int64		usecs;
+
+	if (cstate->time_typid != TIMESTAMPTZOID && cstate->time_typid != TIMESTAMPOID)
+	{
+		/* e.g. an integer column keeps the raw value */
+		return lp_set_column(cstate, cstate->time_attnum, value, values, nulls);
+	}
+
+	ts = pg_strtoint64(value);
+
+	/* Convert to microseconds, rounding toward minus infinity */
+	if (cstate->options.precision < 1000)
+	{
+		int64		div = 1000 / cstate->options.precision;
+
+		usecs = ts / div;
+		if (ts % div < 0)
+			usecs--;
+	}
+	else if (pg_mul_s64_overflow(ts, cstate->options.precision / 1000, &usecs))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				 errmsg("timestamp out of range: \"%s\"", value)));
+
+	usecs -= (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * USECS_PER_DAY;
+
+	if (!IS_VALID_TIMESTAMP(usecs))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				 errmsg("timestamp out of range: \"%s\"", value)));
+
+	values[m] = TimestampTzGetDatum((TimestampTz) usecs);
+	nulls[m] = false;
+
+	return true;
+}
+
+static void
+LineProtocolCopyFromInFunc(CopyFromState cstate, Oid atttypid, FmgrInfo *finfo,
+						   Oid *typioparam)
+{
+	Oid			func_oid;
+
+	getTypeInputInfo(atttypid, &func_oid, typioparam);
+	fmgr_info(func_oid, finfo);
+}
+
+static void
+LineProtocolCopyFromStart(CopyFromState ccstate, TupleDesc tupDesc)
+{
+	CopyFromStateLineProtocol *cstate = (CopyFromStateLineProtocol *) ccstate;
+	List	   *attnumlist = cstate->base.attnumlist;
+	List	   *special = NIL;
+
+	if (cstate->options.precision == 0)
+		cstate->options.precision = 1;
+
+	cstate->measurement_attnum =
+		CopyFindColumn(attnumlist, tupDesc,
+					   cstate->options.measurement_column ? cstate->options.measurement_column : "measurement",
+					   cstate->options.measurement_column != NULL);
+	cstate->time_attnum =
+		CopyFindColumn(attnumlist, tupDesc,
+					   cstate->options.time_column ? cstate->options.time_column : "time",
+					   cstate->options.time_column != NULL);
+	cstate->extra_attnum = 0;
+
+	if (cstate->options.extra_keys_column)
+	{
+		cstate->extra_attnum = CopyFindColumn(attnumlist, tupDesc,
+											  cstate->options.extra_keys_column,
+											  true);
+		if (TupleDescAttr(tupDesc, cstate->extra_attnum - 1)->atttypid != JSONBOID)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("extra_keys_column \"%s\" must be of type jsonb",
+							cstate->options.extra_keys_column)));
+		special = lappend_int(special, cstate->extra_attnum);
+	}
+
+	if (cstate->measurement_attnum != 0)
+		special = lappend_int(special, cstate->measurement_attnum);
+	if (cstate->time_attnum != 0)
+	{
+		cstate->time_typid = TupleDescAttr(tupDesc, cstate->time_attnum - 1)->atttypid;
+		special = lappend_int(special, cstate->time_attnum);
+	}
+
+	cstate->keymap = CopyKeyMapFromColumns(tupDesc, attnumlist, special);
+
+	CopyInputBufferInit((CopyFromState) cstate, &cstate->input,
+						CopyInputDetectCompression(cstate->base.filename));
+
+	if (CopyStatsSharedEnabled())
+		cstate->input.stats = CopyStatsCreate();
+}
+
+static bool
+LineProtocolCopyFromOneRow(CopyFromState ccstate, ExprContext *econtext, Datum *values,
+						   bool *nulls, CopyFromRowInfo *rowinfo)
+{
+	CopyFromStateLineProtocol *cstate = (CopyFromStateLineProtocol *) ccstate;
+	StringInfo	line_buf = &cstate->input.line_buf;
+	JsonbParseState *extra_state = NULL;
+	char	   *r;
+	char	   *end;
+	char	   *token;
+	int			len;
+	char		delim;
+	CopyStats  *stats = cstate->input.stats;
+
+	CopyStatsBeginRow(stats);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_SPLIT);
+
+	/* Skip empty lines and comments */
+	for (;;)
+	{
+		if (CopyInputBufferReadLine((CopyFromState) cstate, &cstate->input))
+			return false;
+
+		/* Accept CRLF line endings as well */
+		if (line_buf->len > 0 && line_buf->data[line_buf->len - 1] == '\r')
+			line_buf->data[--line_buf->len] = '\0';
+
+		r = line_buf->data;
+		end = r + line_buf->len;
+		while (r < end && (*r == ' ' || *r == '\t'))
+			r++;
+
+		if (r < end && *r != '#')
+			break;
+	}
+
+	CopyStatsAddBytes(stats, COPY_PHASE_SPLIT, line_buf->len);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_PARSE);
+
+	if (cstate->extra_attnum != 0)
+		(void) pushJsonbValue(&extra_state, WJB_BEGIN_OBJECT, NULL);
+
+	/* measurement */
+	delim = lp_parse_token(&r, end, false, &token, &len);
+	if (len == 0)
+		lineprotocol_syntax_error(cstate, "missing measurement");
+	if (cstate->measurement_attnum != 0 &&
+		!lp_set_column(cstate, cstate->measurement_attnum, token, values, nulls))
+		goto skip;
+	r++;
+
+	/* tags */
+	while (delim == ',')
+	{
+		char	   *key;
+		int			keylen;
+		char	   *value;
+		int			attnum;
+
+		delim = lp_parse_token(&r, end, true, &key, &keylen);
+		if (delim != '=' || keylen == 0)
+			lineprotocol_syntax_error(cstate, "invalid tag");
+		r++;
+
+		delim = lp_parse_token(&r, end, true, &value, &len);
+		if (delim == '=')
+			lineprotocol_syntax_error(cstate, "invalid tag value");
+		r++;
+
+		attnum = CopyKeyMapLookup(cstate->keymap, key, keylen);
+		if (attnum != 0)
+		{
+			if (!lp_set_column(cstate, attnum, value, values, nulls))
+				goto skip;
+		}
+		else if (extra_state != NULL)
+			lp_push_extra(&extra_state, key, keylen, value, len, LP_VALUE_TAG);
+	}
+
+	if (delim != ' ')
+		lineprotocol_syntax_error(cstate, "missing fields");
+	while (r < end && *r == ' ')
+		r++;
+
+	/* fields */
+	do
+	{
+		char	   *key;
+		int			keylen;
+		char	   *value;
+		LpValueType type;
+		int			attnum;
+
+		delim = lp_parse_token(&r, end, true, &key, &keylen);
+		if (delim != '=' || keylen == 0)
+			lineprotocol_syntax_error(cstate, "invalid field");
+		r++;
+
+		delim = lp_parse_field_value(cstate, &r, end, &value, &len, &type);
+		r++;
+
+		attnum = CopyKeyMapLookup(cstate->keymap, key, keylen);
+		if (attnum != 0)
+		{
+			if (!lp_set_column(cstate, attnum, value, values, nulls))
+				goto skip;
+		}
+		else if (extra_state != NULL)
+			lp_push_extra(&extra_state, key, keylen, value, len, type);
+	} while (delim == ',');
+
+	/* timestamp */
+	while (r < end && *r == ' ')
+		r++;
+
+	if (r < end)
+	{
+		char	   *token_end;
+
+		token = r;
+		while (r < end && *r != ' ')
+			r++;
+		token_end = r;
+
+		/* Only trailing spaces may follow the timestamp */
+		while (r < end && *r == ' ')
+			r++;
+		if (r < end)
+			lineprotocol_syntax_error(cstate, "unexpected data after timestamp");
+		*token_end = '\0';
+
+		if (cstate->time_attnum != 0 &&
+			!lp_set_time(cstate, token, values, nulls))
+			goto skip;
+	}
+	else if (cstate->time_attnum != 0 &&
+			 (cstate->time_typid == TIMESTAMPTZOID || cstate->time_typid == TIMESTAMPOID))
+	{
+		/* Like InfluxDB, use the server time for lines without timestamp */
+		values[cstate->time_attnum - 1] =
+			TimestampTzGetDatum(GetCurrentStatementStartTimestamp());
+		nulls[cstate->time_attnum - 1] = false;
+	}
+
+	if (extra_state != NULL)
+	{
+		JsonbValue *res = pushJsonbValue(&extra_state, WJB_END_OBJECT, NULL);
+
+		if (res->val.object.nPairs > 0)
+		{
+			values[cstate->extra_attnum - 1] = JsonbPGetDatum(JsonbValueToJsonb(res));
+			nulls[cstate->extra_attnum - 1] = false;
+		}
+	}
+
+	/* A skipped row is returned as well, COPY sees the error in escontext */
+skip:
+	/* Set output parameters */
+	if (rowinfo)
+	{
+		rowinfo->lineno = cstate->base.cur_lineno;
+		rowinfo->tuplen = line_buf->len;
+	}
+
+	if (stats != NULL)
+	{
+		/* skipped rows are counted as errors at the end */
+		if (cstate->base.escontext == NULL ||
+			!cstate->base.escontext->error_occurred)
+			stats->rows++;
+		(void) CopyStatsSwitch(stats, COPY_PHASE_OTHER);
+	}
+
+	return true;
+}
+
+static void
+LineProtocolCopyFromEnd(CopyFromState ccstate)
+{
+	CopyFromStateLineProtocol *cstate = (CopyFromStateLineProtocol *) ccstate;
+	CopyStats  *stats = cstate->input.stats;
+
+	if (stats != NULL)
+		CopyStatsEndRows(stats);
+
+	CopyInputBufferEnd(&cstate->input);
+
+	if (stats != NULL)
+	{
+		stats->errors = cstate->base.num_errors;
+		CopyStatsFinish(stats, "lineprotocol", true, false);
+	}
+}
+
+static Size
+LineProtocolCopyFromEstimateSpace(void)
+{
+	return sizeof(CopyFromStateLineProtocol);
+}
+
+static bool
+LineProtocolCopyFromProcessOneOption(CopyFromState ccstate, DefElem *option)
+{
+	CopyFromStateLineProtocol *cstate = (CopyFromStateLineProtocol *) ccstate;
+
+	if (strcmp(option->defname, "measurement_column") == 0)
+	{
+		cstate->options.measurement_column = defGetString(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "time_column") == 0)
+	{
+		cstate->options.time_column = defGetString(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "extra_keys_column") == 0)
+	{
+		cstate->options.extra_keys_column = defGetString(option);
+
+		return true;
+	}
+	else if (strcmp(option->defname, "precision") == 0)
+	{
+		char	   *optval = defGetString(option);
+
+		if (strcmp(optval, "ns") == 0)
+			cstate->options.precision = 1;
+		else if (strcmp(optval, "us") == 0)
+			cstate->options.precision = 1000;
+		else if (strcmp(optval, "ms") == 0)
+			cstate->options.precision = 1000000;
+		else if (strcmp(optval, "s") == 0)
+			cstate->options.precision = 1000000000;
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("unrecognized precision: \"%s\"", optval),
+					 errhint("Valid precisions are \"ns\", \"us\", \"ms\" and \"s\".")));
+
+		return true;
+	}
+
+	return false;
+}
+
+static const CopyFromRoutine LineProtocolCopyFromRoutine = {
+	.CopyFromEstimateStateSpace = LineProtocolCopyFromEstimateSpace,
+	.CopyFromProcessOneOption = LineProtocolCopyFromProcessOneOption,
+	.CopyFromInFunc = LineProtocolCopyFromInFunc,
+	.CopyFromStart = LineProtocolCopyFromStart,
+	.CopyFromOneRow = LineProtocolCopyFromOneRow,
+	.CopyFromEnd = LineProtocolCopyFromEnd,
+};
+
+void
+RegisterLineProtocolCopyFormat(void)
+{
+	RegisterCopyCustomFormat("lineprotocol",
+							 &LineProtocolCopyFromRoutine,
+							 NULL);
+}
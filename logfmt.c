@@ -0,0 +1,510 @@
+/*--------------------------------------------------------------------------
+ *
+ * logfmt.c
+ *		logfmt support for COPY FROM command.
+ *
+ * Each line is a sequence of key=value pairs separated by whitespace:
+ *
+ *	level=info msg="request done" path=/api dur=12ms cached
+ *
+ * Values are either bare words or double-quoted strings with backslash
+ * escapes.  A key without '=' is a flag and has the value "true", and a bare
+ * empty value ("key=") is NULL.  Each key goes to the column of the same
+ * name; keys that match no column are collected into the jsonb
+ * 'extra_keys_column' if given, and dropped otherwise.
+ *
+ * Like lineprotocol.c, the line is tokenized in a single pass in place:
+ * tokens are terminated by overwriting the delimiter that follows them, and
+ * quoted values are unescaped by shifting the remaining bytes down.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		logfmt.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "commands/copyapi.h"
+#include "commands/copystate.h"
+#include "commands/defrem.h"
+#include "port/simd.h"
+#include "utils/builtins.h"
+#include "utils/jsonb.h"
+#include "utils/lsyscache.h"
+
+#include "pg_custom_copy_formats.h"
+
+/*
+ * Struct for COPY options for logfmt format.
+ */
+typedef struct LogfmtOptions
+{
+	char	   *extra_keys_column;
+} LogfmtOptions;
+
+typedef struct CopyFromStateLogfmt
+{
+	CopyFromStateData base;
+
+	LogfmtOptions options;
+
+	/* Attribute number of the extra keys column, or 0 if not given */
+	int			extra_attnum;
+
+	/* Keys to attribute numbers */
+	CopyKeyMap *keymap;
+
+	/* Input pipeline shared with the other text-based formats */
+	CopyInputBuffer input;
+} CopyFromStateLogfmt;
+
+static void
+logfmt_syntax_error(CopyFromStateLogfmt *cstate, const char *msg)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+			 errmsg("invalid logfmt data: %s", msg),
+			 errdetail("Line " UINT64_FORMAT ": \"%s\"",
+					   cstate->base.cur_lineno,
+					   cstate->input.line_buf.data)));
+}
+
+/*
+ * Return the first byte in [p, end) that is whitespace, '=' or '"'.  Returns
+ * 'end' if there is none.
+ */
+static inline char *
+logfmt_scan_key(char *p, char *end)
+{
+#ifndef USE_NO_SIMD
+	while (p + sizeof(Vector8) <= end)
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) p);
+		if (vector8_has(chunk, ' ') || vector8_has(chunk, '\t') ||
+			vector8_has(chunk, '=') || vector8_has(chunk, '"'))
+			break;
+		p += sizeof(Vector8);
+	}
+#endif
+
+	while (p < end && *p != ' ' && *p != '\t' && *p != '=' && *p != '"')
+		p++;
+
+	return p;
+}
+
+/*
+ * Return the first whitespace byte in [p, end), or 'end' if there is none.
+ */
+static inline char *
+logfmt_scan_space(char *p, char *end)
+{
+#ifndef USE_NO_SIMD
+	while (p + sizeof(Vector8) <= end)
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) p);
+		if (vector8_has(chunk, ' ') || vector8_has(chunk, '\t'))
+			break;
+		p += sizeof(Vector8);
+	}
+#endif
+
+	while (p < end && *p != ' ' && *p != '\t')
+		p++;
+
+	return p;
+}
+
+/*
+ * Return the first byte in [p, end) that is '"' or '\\'.  Returns 'end' if
+ * there is none.
+ */
+static inline char *
+logfmt_scan_string(char *p, char *end)
+{
+#ifndef USE_NO_SIMD
+	while (p + sizeof(Vector8) <= end)
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) p);
+		if (vector8_has(chunk, '"') || vector8_has(chunk, '\\'))
+			break;
+		p += sizeof(Vector8);
+	}
+#endif
+
+	while (p < end && *p != '"' && *p != '\\')
+		p++;
+
+	return p;
+}
+
+/*
+ * Parse a quoted value starting at the opening quote *rp.  The value is
+ * unescaped and NUL-terminated in place, and *rp is set to the byte after
+ * the closing quote.
+ */
+static void
+logfmt_parse_string(CopyFromStateLogfmt *cstate, char **rp, char *end,
+					char **value, int *len)
+{
+	char	   *r = *rp + 1;
+	char	   *w = r;
+
+	*value = w;
+
+	for (;;)
+	{
+		char	   *next = logfmt_scan_string(r, end);
+		int			n = next - r;
+
+		if (w != r)
+			memmove(w, r, n);
+		w += n;
+		r = next;
+
+		if (r >= end)
+			logfmt_syntax_error(cstate, "unterminated quoted value");
+
+		if (*r == '"')
+			break;
+
+		/* backslash escape */
+		if (r + 1 >= end)
+			logfmt_syntax_error(cstate, "unterminated quoted value");
+
+		switch (r[1])
+		{
+			case 'n':
+				*w++ = '\n';
+				break;
+			case 't':
+				*w++ = '\t';
+				break;
+			case 'r':
+				*w++ = '\r';
+				break;
+			case '"':
+			case '\\':
+				*w++ = r[1];
+				break;
+			default:
+				/* keep unknown escapes as they are */
+				*w++ = r[0];
+				*w++ = r[1];
+				break;
+		}
+		r += 2;
+	}
+
+	/* skip the closing quote */
+	r++;
+	if (r < end && *r != ' ' && *r != '\t')
+		logfmt_syntax_error(cstate, "unexpected character after quoted value");
+
+	*len = w - *value;
+	*w = '\0';
+	*rp = r;
+}
+
+/*
+ * Add a pair that matches no column to the extra keys object.  'value' is
+ * NULL for a NULL value.
+ */
+static void
+logfmt_push_extra(JsonbParseState **state, char *key, int keylen, char *value,
+				  int len, bool flag)
+{
+	JsonbValue	jbv;
+
+	jbv.type = jbvString;
+	jbv.val.string.val = key;
+	jbv.val.string.len = keylen;
+	(void) pushJsonbValue(state, WJB_KEY, &jbv);
+
+	if (flag)
+	{
+		jbv.type = jbvBool;
+		jbv.val.boolean = true;
+	}
+	else if (value == NULL)
+		jbv.type = jbvNull;
+	else
+	{
+		jbv.type = jbvString;
+		jbv.val.string.val = value;
+		jbv.val.string.len = len;
+	}
+
+	(void) pushJsonbValue(state, WJB_VALUE, &jbv);
+}
+
+/*
+ * Convert the value into the column.  'value' is NULL for a NULL value.
+ * Returns false if the row is skipped after a soft error.
+ */
+static bool
+logfmt_set_column(CopyFromStateLogfmt *cstate, int attnum, char *value,
+				  Datum *values, bool *nulls)
+{
+	int			m = attnum - 1;
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(cstate->base.rel), m);
+
+	if (value == NULL)
+	{
+		/* a later duplicate key overrides an earlier one */
+		nulls[m] = true;
+		return true;
+	}
+
+	if (!InputFunctionCallSafe(&cstate->base.in_functions[m],
+							   value,
+							   cstate->base.typioparams[m],
+							   att->atttypmod,
+							   (Node *) cstate->base.escontext,
+							   &values[m]))
+	{
+		CopyInputSkipRow((CopyFromState) cstate, NameStr(att->attname));
+		return false;
+	}
+
+	nulls[m] = false;
+
+	return true;
+}
+
+static void
+LogfmtCopyFromInFunc(CopyFromState cstate, Oid atttypid, FmgrInfo *finfo,
+					 Oid *typioparam)
+{
+	Oid			func_oid;
+
+	getTypeInputInfo(atttypid, &func_oid, typioparam);
+	fmgr_info(func_oid, finfo);
+}
+
+static void
+LogfmtCopyFromStart(CopyFromState ccstate, TupleDesc tupDesc)
+{
+	CopyFromStateLogfmt *cstate = (CopyFromStateLogfmt *) ccstate;
+	List	   *special = NIL;
+
+	cstate->extra_attnum = 0;
+
+	if (cstate->options.extra_keys_column)
+	{
+		cstate->extra_attnum = CopyFindColumn(cstate->base.attnumlist, tupDesc,
+											  cstate->options.extra_keys_column,
+											  true);
+		if (TupleDescAttr(tupDesc, cstate->extra_attnum - 1)->atttypid != JSONBOID)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("extra_keys_column \"%s\" must be of type jsonb",
+							cstate->options.extra_keys_column)));
+		special = lappend_int(special, cstate->extra_attnum);
+	}
+
+	cstate->keymap = CopyKeyMapFromColumns(tupDesc, cstate->base.attnumlist,
+										   special);
+
+	CopyInputBufferInit((CopyFromState) cstate, &cstate->input,
+						CopyInputDetectCompression(cstate->base.filename));
+
+	if (CopyStatsSharedEnabled())
+		cstate->input.stats = CopyStatsCreate();
+}
+
+static bool
+LogfmtCopyFromOneRow(CopyFromState ccstate, ExprContext *econtext, Datum *values,
+					 bool *nulls, CopyFromRowInfo *rowinfo)
+{
+	CopyFromStateLogfmt *cstate = (CopyFromStateLogfmt *) ccstate;
+	StringInfo	line_buf = &cstate->input.line_buf;
+	JsonbParseState *extra_state = NULL;
+	char	   *r;
+	char	   *end;
+	CopyStats  *stats = cstate->input.stats;
+
+	CopyStatsBeginRow(stats);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_SPLIT);
+
+	/* Skip empty lines */
+	for (;;)
+	{
+		if (CopyInputBufferReadLine((CopyFromState) cstate, &cstate->input))
+			return false;
+
+		/* Accept CRLF line endings as well */
+		if (line_buf->len > 0 && line_buf->data[line_buf->len - 1] == '\r')
+			line_buf->data[--line_buf->len] = '\0';
+
+		r = line_buf->data;
+		end = r + line_buf->len;
+		while (r < end && (*r == ' ' || *r == '\t'))
+			r++;
+
+		if (r < end)
+			break;
+	}
+
+	CopyStatsAddBytes(stats, COPY_PHASE_SPLIT, line_buf->len);
+	(void) CopyStatsSwitch(stats, COPY_PHASE_PARSE);
+
+	if (cstate->extra_attnum != 0)
+		(void) pushJsonbValue(&extra_state, WJB_BEGIN_OBJECT, NULL);
+
+	while (r < end)
+	{
+		char	   *key = r;
+		int			keylen;
+		char	   *value = NULL;
+		int			len = 0;
+		bool		flag = false;
+		int			attnum;
+
+		r = logfmt_scan_key(r, end);
+		keylen = r - key;
+
+		if (r < end && *r == '"')
+			logfmt_syntax_error(cstate, "unexpected quote in key");
+		if (keylen == 0)
+			logfmt_syntax_error(cstate, "missing key");
+
+		if (r < end && *r == '=')
+		{
+			*r++ = '\0';
+
+			if (r < end && *r == '"')
+				logfmt_parse_string(cstate, &r, end, &value, &len);
+			else
+			{
+				value = r;
+				r = logfmt_scan_space(r, end);
+				len = r - value;
+				*r = '\0';
+
+				/* "key=" has a NULL value */
+				if (len == 0)
+					value = NULL;
+			}
+		}
+		else
+		{
+			/* a key without value is a flag */
+			*r = '\0';
+			value = "true";
+			len = 4;
+			flag = true;
+		}
+
+		attnum = CopyKeyMapLookup(cstate->keymap, key, keylen);
+		if (attnum != 0)
+		{
+			if (!logfmt_set_column(cstate, attnum, value, values, nulls))
+				goto skip;
+		}
+		else if (extra_state != NULL)
+			logfmt_push_extra(&extra_state, key, keylen, value, len, flag);
+
+		/* skip the (already overwritten) delimiter and whitespace */
+		if (r < end)
+			r++;
+		while (r < end && (*r == ' ' || *r == '\t'))
+			r++;
+	}
+
+	if (extra_state != NULL)
+	{
+		JsonbValue *res = pushJsonbValue(&extra_state, WJB_END_OBJECT, NULL);
+
+		if (res->val.object.nPairs > 0)
+		{
+			values[cstate->extra_attnum - 1] = JsonbPGetDatum(JsonbValueToJsonb(res));
+			nulls[cstate->extra_attnum - 1] = false;
+		}
+	}
+
+	/* A skipped row is returned as well, COPY sees the error in escontext */
+skip:
+	/* Set output parameters */
+	if (rowinfo)
+	{
+		rowinfo->lineno = cstate->base.cur_lineno;
+		rowinfo->tuplen = line_buf->len;
+	}
+
+	if (stats != NULL)
+	{
+		/* skipped rows are counted as errors at the end */
+		if (cstate->base.escontext == NULL ||
+			!cstate->base.escontext->error_occurred)
+			stats->rows++;
+		(void) CopyStatsSwitch(stats, COPY_PHASE_OTHER);
+	}
+
+	return true;
+}
+
+static void
+LogfmtCopyFromEnd(CopyFromState ccstate)
+{
+	CopyFromStateLogfmt *cstate = (CopyFromStateLogfmt *) ccstate;
+	CopyStats  *stats = cstate->input.stats;
+
+	if (stats != NULL)
+		CopyStatsEndRows(stats);
+
+	CopyInputBufferEnd(&cstate->input);
+
+	if (stats != NULL)
+	{
+		stats->errors = cstate->base.num_errors;
+		CopyStatsFinish(stats, "logfmt", true, false);
+	}
+}
+
+static Size
+LogfmtCopyFromEstimateSpace(void)
+{
+	return sizeof(CopyFromStateLogfmt);
+}
+
+static bool
+LogfmtCopyFromProcessOneOption(CopyFromState ccstate, DefElem *option)
+{
+	CopyFromStateLogfmt *cstate = (CopyFromStateLogfmt *) ccstate;
+
+	if (strcmp(option->defname, "extra_keys_column") == 0)
+	{
+		cstate->options.extra_keys_column = defGetString(option);
+
+		return true;
+	}
+
+	return false;
+}
+
+static const CopyFromRoutine LogfmtCopyFromRoutine = {
+	.CopyFromEstimateStateSpace = LogfmtCopyFromEstimateSpace,
+	.CopyFromProcessOneOption = LogfmtCopyFromProcessOneOption,
+	.CopyFromInFunc = LogfmtCopyFromInFunc,
+	.CopyFromStart = LogfmtCopyFromStart,
+	.CopyFromOneRow = LogfmtCopyFromOneRow,
+	.CopyFromEnd = LogfmtCopyFromEnd,
+};
+
+void
+RegisterLogfmtCopyFormat(void)
+{
+	RegisterCopyCustomFormat("logfmt",
+							 &LogfmtCopyFromRoutine,
+							 NULL);
+}
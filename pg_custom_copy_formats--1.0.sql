@@ -0,0 +1,125 @@
+/* pg_custom_copy_formats--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION pg_custom_copy_formats" to load this file. \quit
+
+CREATE FUNCTION jsonlines_fdw_handler()
+RETURNS fdw_handler
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT;
+
+CREATE FUNCTION jsonlines_fdw_validator(text[], oid)
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT;
+
+CREATE FOREIGN DATA WRAPPER jsonlines_fdw
+  HANDLER jsonlines_fdw_handler
+  VALIDATOR jsonlines_fdw_validator;
+
+CREATE FUNCTION jsonlines_to_record(line text, rowtype anyelement)
+RETURNS anyelement
+AS 'MODULE_PATHNAME'
+LANGUAGE C STABLE PARALLEL SAFE;
+
+CREATE FUNCTION jsonlines_read(path text, rowtype anyelement)
+RETURNS SETOF anyelement
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE PARALLEL SAFE;
+
+CREATE FUNCTION jsonlines_agg_transfn(internal, record)
+RETURNS internal
+AS 'MODULE_PATHNAME'
+LANGUAGE C STABLE PARALLEL SAFE;
+
+CREATE FUNCTION jsonlines_agg_combinefn(internal, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION jsonlines_agg_serialfn(internal)
+RETURNS bytea
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION jsonlines_agg_deserialfn(bytea, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION jsonlines_agg_finalfn(internal)
+RETURNS text
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE AGGREGATE jsonlines_agg(record) (
+  SFUNC = jsonlines_agg_transfn,
+  STYPE = internal,
+  COMBINEFUNC = jsonlines_agg_combinefn,
+  SERIALFUNC = jsonlines_agg_serialfn,
+  DESERIALFUNC = jsonlines_agg_deserialfn,
+  FINALFUNC = jsonlines_agg_finalfn,
+  PARALLEL = SAFE
+);
+
+-- Sources and progress of the jsonlines ingest worker
+CREATE TABLE jsonlines_ingest_sources (
+  source_path text PRIMARY KEY,
+  target regclass NOT NULL
+);
+
+CREATE TABLE jsonlines_ingest_files (
+  file_path text PRIMARY KEY,
+  source_path text NOT NULL
+    REFERENCES jsonlines_ingest_sources ON DELETE CASCADE,
+  read_offset bigint NOT NULL DEFAULT 0,
+  done bool NOT NULL DEFAULT false,
+  error text,
+  file_dev bigint,
+  file_ino bigint,
+  updated_at timestamptz NOT NULL DEFAULT now()
+);
+
+SELECT pg_catalog.pg_extension_config_dump('jsonlines_ingest_sources', '');
+SELECT pg_catalog.pg_extension_config_dump('jsonlines_ingest_files', '');
+
+CREATE FUNCTION jsonlines_ingest_batch(source_path text, file_path text)
+RETURNS bool
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE;
+
+REVOKE ALL ON FUNCTION jsonlines_ingest_batch(text, text) FROM PUBLIC;
+
+-- Cumulative statistics of the custom formats, per format and direction
+CREATE FUNCTION pg_stat_custom_copy(
+  OUT format text,
+  OUT direction text,
+  OUT operations bigint,
+  OUT rows bigint,
+  OUT raw_bytes bigint,
+  OUT compressed_bytes bigint,
+  OUT errors bigint,
+  OUT other_time float8,
+  OUT read_time float8,
+  OUT inflate_time float8,
+  OUT split_time float8,
+  OUT parse_time float8,
+  OUT convert_time float8,
+  OUT encode_time float8,
+  OUT deflate_time float8,
+  OUT write_time float8,
+  OUT stats_reset timestamptz
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE VIEW pg_stat_custom_copy AS
+  SELECT * FROM pg_stat_custom_copy();
+
+CREATE FUNCTION pg_stat_custom_copy_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+REVOKE ALL ON FUNCTION pg_stat_custom_copy_reset() FROM PUBLIC;
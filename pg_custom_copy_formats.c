@@ -21,4 +21,12 @@ void
 _PG_init(void)
 {
 	RegisterJsonLinesCopyFormat();
+	RegisterTsColumnarCopyFormat();
+	RegisterFixedWidthCopyFormat();
+	RegisterLineProtocolCopyFormat();
+	RegisterLogfmtCopyFormat();
+	RegisterFastCsvCopyFormat();
+
+	RegisterJsonLinesIngestWorker();
+	RegisterCopySharedStats();
 }
@@ -14,6 +14,429 @@
 #ifndef CUSTOM_COPY_FORMATS_H
 #define CUSTOM_COPY_FORMATS_H
 
+#include "access/tupdesc.h"
+#include "commands/copyapi.h"
+#include "common/compression.h"
+#include "common/hashfn.h"
+#include "lib/stringinfo.h"
+#include "portability/instr_time.h"
+#include "utils/jsonb.h"
+#include "utils/jsonfuncs.h"
+#include "utils/pg_rusage.h"
+
+#ifdef HAVE_LIBZ
+#include "zlib.h"
+#endif
+
+/*
+ * Per-phase statistics of a COPY operation, collected with the 'stats'
+ * option or for the cumulative statistics in shared memory.  Built by
+ * copystats.c.
+ *
+ * The time is charged to the current phase, which the code switches as it
+ * moves between the phases, so the phases never overlap.  To keep the cost
+ * low, the time is measured for one row out of COPY_STATS_SAMPLE_RATE and
+ * scaled up, while the work done outside of rows (e.g. at the end) is always
+ * measured.
+ */
+typedef enum CopyStatsPhase
+{
+	COPY_PHASE_OTHER,			/* outside of the format, e.g. insertion */
+	COPY_PHASE_READ,			/* reading the source */
+	COPY_PHASE_INFLATE,			/* decompressing the input */
+	COPY_PHASE_SPLIT,			/* splitting the input into records */
+	COPY_PHASE_PARSE,			/* parsing records */
+	COPY_PHASE_CONVERT,			/* converting values into columns */
+	COPY_PHASE_ENCODE,			/* encoding rows */
+	COPY_PHASE_DEFLATE,			/* compressing the output */
+	COPY_PHASE_WRITE,			/* sending the output */
+} CopyStatsPhase;
+
+#define COPY_NUM_PHASES			(COPY_PHASE_WRITE + 1)
+#define COPY_STATS_SAMPLE_RATE	16
+
+typedef struct CopyStats
+{
+	PGRUsage	ru_start;		/* at the start of the operation */
+	uint64		nrows_started;	/* calls of CopyStatsBeginRow() */
+	uint64		rows;
+	uint64		errors;			/* rows skipped by ON_ERROR ignore */
+	uint64		phase_ns[COPY_NUM_PHASES];
+	uint64		phase_bytes[COPY_NUM_PHASES];
+	bool		timing;			/* report the time and the CPU usage */
+
+	CopyStatsPhase phase;		/* current phase */
+	int			weight;			/* of the time measured now, or 0 */
+	instr_time	phase_start;
+} CopyStats;
+
+/*
+ * Switch to the given phase, returning the previous one.
+ */
+static inline CopyStatsPhase
+CopyStatsSwitch(CopyStats *stats, CopyStatsPhase phase)
+{
+	CopyStatsPhase prev;
+
+	if (likely(stats == NULL))
+		return COPY_PHASE_OTHER;
+
+	prev = stats->phase;
+	if (stats->weight > 0)
+	{
+		instr_time	now;
+		instr_time	elapsed;
+
+		INSTR_TIME_SET_CURRENT(now);
+		elapsed = now;
+		INSTR_TIME_SUBTRACT(elapsed, stats->phase_start);
+		stats->phase_ns[prev] += INSTR_TIME_GET_NANOSEC(elapsed) * stats->weight;
+		stats->phase_start = now;
+	}
+	stats->phase = phase;
+
+	return prev;
+}
+
+/*
+ * Called at the start of each row.  The time after the previous row is
+ * charged to COPY_PHASE_OTHER.
+ */
+static inline void
+CopyStatsBeginRow(CopyStats *stats)
+{
+	if (likely(stats == NULL))
+		return;
+
+	(void) CopyStatsSwitch(stats, COPY_PHASE_OTHER);
+
+	if (++stats->nrows_started % COPY_STATS_SAMPLE_RATE == 0)
+	{
+		stats->weight = COPY_STATS_SAMPLE_RATE;
+		INSTR_TIME_SET_CURRENT(stats->phase_start);
+	}
+	else
+		stats->weight = 0;
+}
+
+static inline void
+CopyStatsAddBytes(CopyStats *stats, CopyStatsPhase phase, uint64 nbytes)
+{
+	if (unlikely(stats != NULL))
+		stats->phase_bytes[phase] += nbytes;
+}
+
+/* copystats.c */
+extern CopyStats *CopyStatsCreate(void);
+extern void CopyStatsEndRows(CopyStats *stats);
+extern void CopyStatsFinish(CopyStats *stats, const char *format, bool is_from,
+							bool report);
+extern bool CopyStatsSharedEnabled(void);
+extern void RegisterCopySharedStats(void);
+
+/*
+ * Custom wait events reported while the formats run the compression library,
+ * shown in pg_stat_activity.  Reading and writing the data are covered by the
+ * wait events of COPY itself.
+ */
+typedef enum CopyWaitEvent
+{
+	COPY_WAIT_INFLATE,
+	COPY_WAIT_DEFLATE,
+} CopyWaitEvent;
+
+#define COPY_NUM_WAIT_EVENTS	(COPY_WAIT_DEFLATE + 1)
+
+extern uint32 CopyWaitEventInfo(CopyWaitEvent event);
+
+/*
+ * Buffered input pipeline shared by the text-based formats.
+ *
+ * raw_buf holds compressed data loaded from the source, input_buf holds the
+ * (decompressed) input data, and line_buf holds the current line or record.
+ * raw_buf is used only when the input is compressed.
+ */
+typedef struct CopyInputBuffer
+{
+	pg_compress_algorithm compression;
+
+#ifdef HAVE_LIBZ
+	z_stream	strm;
+#endif
+
+#define RAW_BUF_SIZE 65536		/* we palloc RAW_BUF_SIZE+1 bytes */
+	char	   *raw_buf;
+	int			raw_buf_index;	/* next byte to process */
+	int			raw_buf_len;	/* total # of bytes stored */
+	/* Shorthand for number of unconsumed bytes available in raw_buf */
+#define RAW_BUF_BYTES(buf) ((buf)->raw_buf_len - (buf)->raw_buf_index)
+
+	StringInfoData line_buf;
+
+#define INPUT_BUF_SIZE 65536	/* we palloc INPUT_BUF_SIZE+1 bytes */
+	char	   *input_buf;
+	int			input_buf_index;	/* next byte to process */
+	int			input_buf_len;	/* total # of bytes stored */
+	bool		input_reached_eof;	/* true if we reached EOF */
+	/* Shorthand for number of unconsumed bytes available in input_buf */
+#define INPUT_BUF_BYTES(buf) ((buf)->input_buf_len - (buf)->input_buf_index)
+
+	CopyStats  *stats;			/* NULL unless collecting statistics */
+} CopyInputBuffer;
+
+/*
+ * Open-addressing hash table mapping keys to attribute numbers.  Built by
+ * keymap.c; a value of 0 marks an unused entry.
+ */
+typedef struct CopyKeyMapEntry
+{
+	const char *key;
+	int			keylen;
+	uint32		hash;
+	int			value;
+} CopyKeyMapEntry;
+
+typedef struct CopyKeyMap
+{
+	int			size;			/* number of entries, a power of 2 */
+	int			nkeys;
+	CopyKeyMapEntry *entries;
+} CopyKeyMap;
+
+/*
+ * Look up the value for the given key.  Returns 0 if not found.
+ */
+static inline int
+CopyKeyMapLookup(const CopyKeyMap *map, const char *key, int keylen)
+{
+	uint32		hash = hash_bytes((const unsigned char *) key, keylen);
+	uint32		mask = map->size - 1;
+
+	for (uint32 i = hash & mask;; i = (i + 1) & mask)
+	{
+		const CopyKeyMapEntry *entry = &map->entries[i];
+
+		if (entry->value == 0)
+			return 0;
+
+		if (entry->hash == hash && entry->keylen == keylen &&
+			memcmp(entry->key, key, keylen) == 0)
+			return entry->value;
+	}
+}
+
+/*
+ * Cache of converted values for a column, mapping the input text of a value
+ * to the Datum its input function returned.  Built by convcache.c.
+ *
+ * Entries are never replaced, so cached by-reference values stay valid as
+ * long as the cache.  The cache disables itself when less than half of the
+ * lookups in a window hit.
+ */
+#define CONV_CACHE_SIZE			512 /* number of entries, a power of 2 */
+#define CONV_CACHE_MAX_KEYS		256
+#define CONV_CACHE_MAX_KEYLEN	64
+#define CONV_CACHE_MAX_VALUELEN	64
+#define CONV_CACHE_WINDOW		1024
+
+typedef struct CopyConvCacheEntry
+{
+	const char *key;			/* NULL if unused */
+	int			keylen;
+	uint32		hash;
+	Datum		value;
+} CopyConvCacheEntry;
+
+typedef struct CopyConvCache
+{
+	MemoryContext context;		/* where keys and values are copied to */
+	int16		typlen;
+	bool		typbyval;
+	bool		enabled;
+	int			nkeys;
+	int			lookups;		/* in the current window */
+	int			hits;
+	CopyConvCacheEntry entries[CONV_CACHE_SIZE];
+} CopyConvCache;
+
+extern void CopyConvCacheCheckHitRate(CopyConvCache *cache);
+
+/*
+ * Look up the converted value of the given input text.  On a miss, '*hash'
+ * is set for CopyConvCacheInsert().
+ */
+static inline bool
+CopyConvCacheLookup(CopyConvCache *cache, const char *key, int keylen,
+					uint32 *hash, Datum *value)
+{
+	uint32		mask = CONV_CACHE_SIZE - 1;
+
+	if (!cache->enabled || keylen > CONV_CACHE_MAX_KEYLEN)
+		return false;
+
+	*hash = hash_bytes((const unsigned char *) key, keylen);
+
+	if (++cache->lookups >= CONV_CACHE_WINDOW)
+		CopyConvCacheCheckHitRate(cache);
+
+	for (uint32 i = *hash & mask;; i = (i + 1) & mask)
+	{
+		const CopyConvCacheEntry *entry = &cache->entries[i];
+
+		if (entry->key == NULL)
+			return false;
+
+		if (entry->hash == *hash && entry->keylen == keylen &&
+			memcmp(entry->key, key, keylen) == 0)
+		{
+			cache->hits++;
+			*value = entry->value;
+			return true;
+		}
+	}
+}
+
+/* convcache.c */
+extern CopyConvCache *CopyConvCacheCreate(Oid typid);
+extern void CopyConvCacheInsert(CopyConvCache *cache, const char *key,
+								int keylen, uint32 hash, Datum value);
+
+/* keymap.c */
+extern CopyKeyMap *CopyKeyMapCreate(int nkeys);
+extern void CopyKeyMapInsert(CopyKeyMap *map, const char *key, int keylen,
+							 int value);
+extern CopyKeyMap *CopyKeyMapFromColumns(TupleDesc tupdesc, List *attnumlist,
+										 List *exclude);
+extern int	CopyFindColumn(List *attnumlist, TupleDesc tupdesc, const char *name,
+						   bool required);
+
+/*
+ * Per-column state of JsonLinesRowEncoder.
+ */
+typedef struct JsonLinesColumnEncoder
+{
+	int			attnum;
+	char	   *key;			/* escaped column name followed by ':' */
+	int			keylen;
+	JsonTypeCategory tcategory;
+	Oid			outfuncoid;
+	FmgrInfo	outfunc;
+} JsonLinesColumnEncoder;
+
+/*
+ * Precompiled encoder of rows into JSON, built by jsonenc.c.
+ */
+typedef struct JsonLinesRowEncoder
+{
+	int			ncolumns;
+	JsonLinesColumnEncoder *columns;
+	bool		omit_nulls;		/* leave out keys of NULL values */
+} JsonLinesRowEncoder;
+
+/* jsonenc.c */
+extern JsonLinesRowEncoder *JsonLinesCreateRowEncoder(TupleDesc tupdesc,
+													  List *attnumlist);
+extern void JsonLinesEncodeDatum(JsonLinesColumnEncoder *col, Datum value,
+								 StringInfo buf);
+extern void JsonLinesEncodeRow(JsonLinesRowEncoder *enc, Datum *values,
+							   bool *nulls, StringInfo buf);
+extern void JsonLinesEncodeRowArray(JsonLinesRowEncoder *enc, Datum *values,
+									bool *nulls, StringInfo buf);
+
+/*
+ * Decoder of JSON documents into rows, built by jsondec.c.
+ */
+typedef struct JsonLinesRowDecoder
+{
+	TupleDesc	tupdesc;
+	List	   *attnumlist;
+	FmgrInfo   *in_functions;	/* indexed by attnum - 1 */
+	Oid		   *typioparams;
+	struct JsonLinesTypeConverter **converters; /* NULL for scalar columns */
+	CopyConvCache **caches;		/* NULL for uncached columns */
+	struct JsonLinesPathNode *paths;	/* trie of the column paths */
+	int			extra_attnum;	/* extra_keys_column, or 0 */
+	CopyKeyMap *known_keys;		/* top-level keys of the paths */
+	int			error_attnum;	/* column that failed to convert, or 0 */
+	StringInfoData buf;			/* scratch buffer */
+} JsonLinesRowDecoder;
+
+/* jsondec.c */
+extern JsonLinesRowDecoder *JsonLinesCreateRowDecoder(TupleDesc tupdesc,
+													  List *attnumlist,
+													  FmgrInfo *in_functions,
+													  Oid *typioparams,
+													  char *column_paths,
+													  char *extra_keys_column);
+extern bool JsonLinesDecodeValue(JsonLinesRowDecoder *dec, int attnum,
+								 JsonbValue *v, Datum *values, bool *nulls,
+								 Node *escontext);
+extern bool JsonLinesDecodeRow(JsonLinesRowDecoder *dec, Jsonb *jb,
+							   Datum *values, bool *nulls, Node *escontext);
+
+/* sidetable.c */
+
+/* Flush the buffer of a side table once it holds this many rows */
+#define COPY_SIDE_TABLE_BUFFERED_TUPLES	1000
+
+/*
+ * A table written by COPY FROM besides its target table, i.e. a route table
+ * or the error table.
+ */
+typedef struct CopySideTable
+{
+	Relation	rel;
+	EState	   *estate;
+	ResultRelInfo *resultRelInfo;
+	struct BulkInsertStateData *bistate;
+
+	/* Buffered rows, whose values live in 'context' */
+	MemoryContext context;
+	TupleTableSlot *slots[COPY_SIDE_TABLE_BUFFERED_TUPLES];
+	int			nused;
+	uint64		processed;
+} CopySideTable;
+
+extern CopySideTable *CopySideTableOpen(const char *tablename, const char *kind);
+extern TupleTableSlot *CopySideTableNextSlot(CopySideTable *side);
+extern void CopySideTableInsert(CopySideTable *side, TupleTableSlot *slot);
+extern uint64 CopySideTableClose(CopySideTable *side);
+
+/* jsonroute.c */
+typedef struct JsonLinesRouter JsonLinesRouter;
+
+extern JsonLinesRouter *JsonLinesCreateRouter(char *route_key, char *routes);
+extern bool JsonLinesRouteRow(JsonLinesRouter *router, Jsonb *jb);
+extern uint64 JsonLinesFinishRouter(JsonLinesRouter *router);
+
+/* errtable.c */
+typedef struct CopyErrorTable CopyErrorTable;
+
+extern CopyErrorTable *CopyErrorTableOpen(const char *tablename);
+extern void CopyErrorTableAdd(CopyErrorTable *errtab, uint64 lineno,
+							  const char *colname, const char *message,
+							  const char *line);
+extern void CopyErrorTableClose(CopyErrorTable *errtab);
+
+/* inputbuf.c */
+extern pg_compress_algorithm CopyInputDetectCompression(const char *filename);
+extern void CopyInputBufferInit(CopyFromState cstate, CopyInputBuffer *buf,
+								pg_compress_algorithm compression);
+extern bool CopyInputBufferLoad(CopyFromState cstate, CopyInputBuffer *buf);
+extern bool CopyInputBufferReadLine(CopyFromState cstate, CopyInputBuffer *buf);
+extern bool CopyInputBufferReadBytes(CopyFromState cstate, CopyInputBuffer *buf,
+									 int nbytes);
+extern void CopyInputSkipRow(CopyFromState cstate, const char *attname);
+extern void CopyInputBufferEnd(CopyInputBuffer *buf);
+
 extern void RegisterJsonLinesCopyFormat(void);
+extern void RegisterTsColumnarCopyFormat(void);
+extern void RegisterFixedWidthCopyFormat(void);
+extern void RegisterLineProtocolCopyFormat(void);
+extern void RegisterLogfmtCopyFormat(void);
+extern void RegisterFastCsvCopyFormat(void);
+
+/* jsonlines_ingest.c */
+extern void RegisterJsonLinesIngestWorker(void);
 
 #endif
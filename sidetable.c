@@ -0,0 +1,212 @@
+/*--------------------------------------------------------------------------
+ *
+ * sidetable.c
+ *		Bulk insertion into tables other than the target table of COPY FROM.
+ *
+ * The route tables of jsonroute.c and the error table of errtable.c are
+ * written while COPY FROM loads its target table.  Their rows are buffered
+ * in slots and written out with table_multi_insert() when the buffer is full
+ * and at the end of COPY.  The indexes and the constraints of the tables are
+ * maintained, but they must be plain tables without row triggers or
+ * row-level security.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		sidetable.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "catalog/namespace.h"
+#include "catalog/objectaddress.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "parser/parse_relation.h"
+#include "utils/acl.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/regproc.h"
+#include "utils/rls.h"
+
+#include "copyprobes.h"
+#include "pg_custom_copy_formats.h"
+
+/*
+ * Open the table and set up the executor state to insert into it.  'kind'
+ * names the table in the error messages, e.g. "route table".
+ */
+CopySideTable *
+CopySideTableOpen(const char *tablename, const char *kind)
+{
+	CopySideTable *side = palloc0(sizeof(CopySideTable));
+	RangeVar   *rv = makeRangeVarFromNameList(stringToQualifiedNameList(tablename, NULL));
+	Relation	rel;
+	ParseState *pstate;
+	ParseNamespaceItem *nsitem;
+	AclResult	aclresult;
+
+	rel = table_openrv(rv, RowExclusiveLock);
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("%s \"%s\" must be a plain table",
+						kind, RelationGetRelationName(rel))));
+
+	if (rel->trigdesc != NULL &&
+		(rel->trigdesc->trig_insert_before_row ||
+		 rel->trigdesc->trig_insert_after_row ||
+		 rel->trigdesc->trig_insert_instead_row ||
+		 rel->trigdesc->trig_insert_new_table))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s \"%s\" must not have row triggers",
+						kind, RelationGetRelationName(rel))));
+
+	aclresult = pg_class_aclcheck(RelationGetRelid(rel), GetUserId(), ACL_INSERT);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, get_relkind_objtype(rel->rd_rel->relkind),
+					   RelationGetRelationName(rel));
+
+	if (check_enable_rls(RelationGetRelid(rel), InvalidOid, false) == RLS_ENABLED)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s \"%s\" must not have row-level security enabled",
+						kind, RelationGetRelationName(rel))));
+
+	side->rel = rel;
+
+	/* Set up a range table with the table, like COPY does */
+	pstate = make_parsestate(NULL);
+	nsitem = addRangeTableEntryForRelation(pstate, rel, RowExclusiveLock,
+										   NULL, false, false);
+	nsitem->p_perminfo->requiredPerms = ACL_INSERT;
+
+	side->estate = CreateExecutorState();
+	side->estate->es_output_cid = GetCurrentCommandId(true);
+	ExecInitRangeTable(side->estate, pstate->p_rtable, pstate->p_rteperminfos,
+					   bms_make_singleton(1));
+
+	side->resultRelInfo = makeNode(ResultRelInfo);
+	InitResultRelInfo(side->resultRelInfo, rel, 1, NULL, 0);
+	ExecOpenIndices(side->resultRelInfo, false);
+
+	side->bistate = GetBulkInsertState();
+
+	side->context = AllocSetContextCreate(CurrentMemoryContext,
+										  "copy side table",
+										  ALLOCSET_DEFAULT_SIZES);
+
+	return side;
+}
+
+/*
+ * Write out the buffered rows.
+ */
+static void
+sidetable_flush(CopySideTable *side)
+{
+	ResultRelInfo *resultRelInfo = side->resultRelInfo;
+	EState	   *estate = side->estate;
+
+	if (side->nused == 0)
+		return;
+
+	TRACE_COPY_TABLE_FLUSH(RelationGetRelid(side->rel), side->nused);
+
+	table_multi_insert(side->rel, side->slots, side->nused,
+					   estate->es_output_cid, 0, side->bistate);
+
+	if (resultRelInfo->ri_NumIndices > 0)
+	{
+		for (int i = 0; i < side->nused; i++)
+		{
+			List	   *recheckIndexes;
+
+			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
+												   side->slots[i], estate,
+												   false, false, NULL, NIL,
+												   false);
+			list_free(recheckIndexes);
+		}
+	}
+
+	for (int i = 0; i < side->nused; i++)
+		ExecClearTuple(side->slots[i]);
+
+	side->processed += side->nused;
+	side->nused = 0;
+
+	ResetPerTupleExprContext(estate);
+	MemoryContextReset(side->context);
+}
+
+/*
+ * Return the empty slot for the next row.  The caller fills its values,
+ * allocated in side->context, and passes it to CopySideTableInsert().
+ */
+TupleTableSlot *
+CopySideTableNextSlot(CopySideTable *side)
+{
+	if (side->slots[side->nused] == NULL)
+		side->slots[side->nused] =
+			table_slot_create(side->rel, &side->estate->es_tupleTable);
+
+	return ExecClearTuple(side->slots[side->nused]);
+}
+
+/*
+ * Check the row filled in the slot and add it to the buffer.
+ */
+void
+CopySideTableInsert(CopySideTable *side, TupleTableSlot *slot)
+{
+	TupleDesc	tupdesc = RelationGetDescr(side->rel);
+	MemoryContext oldcxt;
+
+	Assert(slot == side->slots[side->nused]);
+
+	oldcxt = MemoryContextSwitchTo(side->context);
+
+	ExecStoreVirtualTuple(slot);
+
+	if (tupdesc->constr && tupdesc->constr->has_generated_stored)
+		ExecComputeStoredGenerated(side->resultRelInfo, side->estate, slot,
+								   CMD_INSERT);
+
+	if (tupdesc->constr)
+		ExecConstraints(side->resultRelInfo, slot, side->estate);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	if (++side->nused >= COPY_SIDE_TABLE_BUFFERED_TUPLES)
+		sidetable_flush(side);
+}
+
+/*
+ * Write out the buffered rows and close the table.  Returns the number of
+ * rows inserted into it.
+ */
+uint64
+CopySideTableClose(CopySideTable *side)
+{
+	sidetable_flush(side);
+
+	FreeBulkInsertState(side->bistate);
+	table_finish_bulk_insert(side->rel, 0);
+	ExecCloseIndices(side->resultRelInfo);
+	ExecResetTupleTable(side->estate->es_tupleTable, false);
+	FreeExecutorState(side->estate);
+	MemoryContextDelete(side->context);
+	table_close(side->rel, NoLock);
+
+	return side->processed;
+}
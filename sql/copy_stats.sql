@@ -0,0 +1,32 @@
+select pg_stat_custom_copy_reset();
+
+create table cs (i int, t text);
+copy cs from stdin with (format 'jsonlines', on_error ignore);
+{"i": 1, "t": "a"}
+{"i": "x", "t": "b"}
+{"i": 3, "t": "c"}
+\.
+copy cs to stdout with (format 'jsonlines');
+copy cs from stdin with (format 'logfmt');
+i=5 t=e
+i=6 t=f
+\.
+copy cs to stdout with (format 'fixedwidth', layout 'i=0:3, t=3:2');
+
+select format, direction, operations, rows, raw_bytes, compressed_bytes, errors
+  from pg_stat_custom_copy order by format, direction;
+select bool_and(read_time >= 0 and parse_time >= 0 and write_time >= 0)
+  from pg_stat_custom_copy;
+
+select pg_stat_custom_copy_reset();
+select count(*) from pg_stat_custom_copy;
+
+-- the wait events are registered on first use
+\getenv abs_builddir PG_ABS_BUILDDIR
+\set filename :abs_builddir '/results/copy_stats.data.gz'
+copy cs to :'filename' with (format 'jsonlines', compression 'gzip');
+copy cs from :'filename' with (format 'jsonlines');
+select name from pg_wait_events
+  where type = 'Extension' and name like 'CopyCustomFormat%' order by name;
+
+drop table cs;
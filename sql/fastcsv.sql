@@ -0,0 +1,40 @@
+load 'pg_custom_copy_formats';
+
+create table fc (i int, t text, n numeric);
+
+copy fc from stdin with (format 'fastcsv', header true);
+i,t,n
+1,hello,1.5
+2,"with ""quotes"", and comma",
+3,"multi
+line",-2
+4,,0
+5,"",1
+\.
+
+copy fc from stdin with (format 'fastcsv', delimiter '|', null 'NULL');
+6|NULL|NULL
+7|"NULL"|3
+\.
+
+select i, t is null as t_null, replace(t, E'\n', '|') as t, n from fc order by i;
+
+-- rows whose values can't be converted are skipped
+copy fc from stdin with (format 'fastcsv', on_error ignore, log_verbosity verbose);
+8,ok,8
+x,bad,9
+10,bad,abc
+\.
+
+select * from fc where i >= 8 order by i;
+
+-- a quoted section may start in the middle of a field
+copy fc from stdin with (format 'fastcsv');
+11,ab"c,d"e,1
+\.
+
+select * from fc where i = 11;
+
+-- error cases
+copy fc from stdin with (format 'fastcsv', delimiter '"');
+copy fc from stdin with (format 'fastcsv', delimiter ';;');
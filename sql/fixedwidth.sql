@@ -0,0 +1,27 @@
+load 'pg_custom_copy_formats';
+
+create table fw (id int, name text, amount numeric);
+
+copy fw from stdin with (format 'fixedwidth', layout 'id=0:5, name=5:10, amount=15:8');
+    1alice        10.50
+   22bob            -3
+  333                0.1
+\.
+
+select * from fw order by id;
+
+copy fw to stdout with (format 'fixedwidth', layout 'id=0:5, name=5:10, amount=15:8');
+
+-- rows whose values can't be converted are skipped
+copy fw from stdin with (format 'fixedwidth', layout 'id=0:5, name=5:10, amount=15:8', on_error ignore, log_verbosity verbose);
+    4dave           1.5
+    xeve              2
+    6frank          abc
+\.
+
+select * from fw where id > 3 order by id;
+
+-- error cases
+copy fw from stdin with (format 'fixedwidth');
+copy fw from stdin with (format 'fixedwidth', layout 'id=0:5, name=5:10');
+copy fw to stdout with (format 'fixedwidth', layout 'id=0:5, name=4:10, amount=15:8');
@@ -9,6 +9,178 @@ copy test to stdout with (format 'jsonlines');
 
 copy test from stdin with (format 'jsonlines');
 1    100.99    'hello'	  '{"a" : "foo"}'
+\.
 
 select * from test order by 1;
 
+
+-- array and seq modes
+truncate test_in;
+copy test_in from stdin with (format 'jsonlines', mode 'array');
+[
+  {"i": 1, "f": 0.5, "t": "one", "jb": [1, 2]},
+  {"i": 2,
+   "t": "two, \"quoted\" ]"}
+]
+\.
+copy test_in from stdin with (format 'jsonlines', mode 'seq');
+{"i": 3,
+ "t": "three"}{"i": 4}
+{
+  "i": 5, "jb": {"nested": {"x": "}"}}
+}
+\.
+select * from test_in order by i;
+
+-- jsonlines_compact format
+copy test to stdout with (format 'jsonlines_compact');
+copy (select i, t from test) to stdout with (format 'jsonlines_compact');
+truncate test_in;
+copy test_in from stdin with (format 'jsonlines_compact');
+{"columns":[{"name":"t","type":"text"},{"name":"i","type":"integer"},"jb"]}
+["one",1,{"a":1}]
+[null,2]
+["three",3,null]
+\.
+select * from test_in order by i;
+copy test_in from stdin with (format 'jsonlines_compact');
+{"columns":["i"]}
+[4,"extra"]
+\.
+copy test_in from stdin with (format 'jsonlines_compact', mode 'array');
+
+-- omit_nulls
+insert into test values (2, null, null, null);
+copy test to stdout with (format 'jsonlines', omit_nulls true);
+copy test (i, t) to stdout with (format 'jsonlines', omit_nulls false);
+copy test to stdout with (format 'jsonlines_compact', omit_nulls true);
+
+-- column_paths
+create table nested (user_id int, cc text, first_tag text, geo jsonb, name text);
+copy nested from stdin with (format 'jsonlines', column_paths 'user_id=$.user.id, cc=$.user.geo.cc, first_tag=$.tags[0], geo=$.user.geo');
+{"user": {"id": 1, "geo": {"cc": "DE"}}, "tags": ["a", "b"], "name": "x"}
+{"user": {"id": 2}, "tags": []}
+{"name": "y"}
+\.
+select * from nested order by user_id;
+copy nested from stdin with (format 'jsonlines', column_paths 'user_id=$.user[x]');
+copy nested from stdin with (format 'jsonlines', column_paths 'nosuch=$.a');
+
+-- extra_keys_column
+create table events (id int, kind text, attrs jsonb);
+copy events from stdin with (format 'jsonlines', extra_keys_column 'attrs');
+{"id": 1, "kind": "click", "x": 10, "meta": {"ua": "curl", "tags": [1, 2]}}
+{"id": 2, "kind": "view"}
+{"id": 3, "attrs": "not a column", "y": null}
+\.
+select * from events order by id;
+copy events from stdin with (format 'jsonlines', extra_keys_column 'kind');
+
+-- routing
+create table ev_default (type text, id int);
+create table ev_click (id int primary key, x int);
+create table ev_view (id int, page text, check (id > 0));
+copy ev_default from stdin with (format 'jsonlines', route_key 'type', routes 'click=ev_click, view=ev_view');
+{"type": "click", "id": 1, "x": 10}
+{"type": "view", "id": 2, "page": "/a"}
+{"type": "other", "id": 3}
+{"id": 4}
+{"type": "click", "id": 5}
+\.
+select * from ev_default order by id;
+select * from ev_click order by id;
+select * from ev_view order by id;
+copy ev_default from stdin with (format 'jsonlines', route_key 'type', routes 'click=ev_click');
+{"type": "click", "id": 1}
+\.
+copy ev_default from stdin with (format 'jsonlines', route_key 'type');
+copy ev_default from stdin with (format 'jsonlines', route_key 'type', routes 'click');
+copy ev_default from stdin with (format 'jsonlines', route_key 'type', routes 'a=ev_click, a=ev_view');
+
+-- document_column
+create table raw_b (doc jsonb);
+copy raw_b from stdin with (format 'jsonlines', document_column 'doc');
+{"b": 1,  "a": [1, 2]}
+"scalar"
+\.
+select * from raw_b;
+create table raw_j (id int default 7, doc json, note text);
+copy raw_j from stdin with (format 'jsonlines', document_column 'doc');
+{"b": 1,  "a": [1, 2]}
+\.
+copy raw_j (note, doc) from stdin with (format 'jsonlines', document_column 'doc');
+{"id": 1, "note": "x"}
+\.
+select * from raw_j;
+copy raw_j from stdin with (format 'jsonlines', document_column 'doc');
+{"broken":
+\.
+copy raw_j from stdin with (format 'jsonlines', document_column 'note');
+copy raw_j from stdin with (format 'jsonlines', document_column 'nosuch');
+copy raw_j from stdin with (format 'jsonlines', document_column 'doc', column_paths 'id=$.a');
+copy raw_j from stdin with (format 'jsonlines_compact', document_column 'doc');
+
+-- ON_ERROR ignore and error_table
+create table soft (id int, v int);
+create table soft_errors (lineno bigint, column_name text, message text, raw_line text, source text default 'stdin');
+copy soft from stdin with (format 'jsonlines', on_error ignore, log_verbosity verbose, error_table 'soft_errors');
+{"id": 1, "v": 10}
+{"id": "x", "v": 20}
+not json
+[1, 2]
+{"id": 5, "v": 99999999999}
+{"id": 6, "v": 60}
+\.
+select * from soft order by id;
+select * from soft_errors order by lineno;
+copy soft from stdin with (format 'jsonlines', on_error ignore, reject_limit 1);
+{"id": "x"}
+{"id": "y"}
+\.
+copy soft from stdin with (format 'jsonlines', error_table 'soft_errors');
+copy soft from stdin with (format 'jsonlines', on_error ignore, error_table 'soft');
+
+-- arrays and composite types
+create type geo_t as (cc text, lat float8, tags text[]);
+create table typed (id int, ints int[], texts varchar(3)[], mat float8[], geo geo_t, geos geo_t[]);
+copy typed from stdin with (format 'jsonlines');
+{"id": 1, "ints": [1, 2, null], "texts": ["a", "b c"], "mat": [[1.5, 2], [3, 4]], "geo": {"cc": "DE", "lat": 52.5, "tags": ["x", "y"]}, "geos": [{"cc": "FR"}, null]}
+{"id": 2, "ints": [], "texts": "{x,y}", "mat": [[]], "geo": "(JP,35.6,)"}
+\.
+select * from typed order by id;
+select id, array_dims(mat), (geo).tags[2], geos[1].cc from typed order by id;
+copy typed from stdin with (format 'jsonlines');
+{"id": 3, "mat": [[1], [2, 3]]}
+\.
+copy typed from stdin with (format 'jsonlines');
+{"id": 4, "geo": {"lat": "north"}}
+\.
+
+-- cached conversion of repeated values
+\getenv abs_builddir PG_ABS_BUILDDIR
+\set filename :abs_builddir '/results/jsonlines_convcache.data'
+create type mood as enum ('sad', 'ok', 'happy');
+create domain digit as int check (value between 0 and 9);
+create table conv (id int, status text, m mood, d digit, ts timestamptz);
+insert into conv
+  select i, 'status' || i % 5, (enum_range(null::mood))[i % 3 + 1], i % 10,
+         '2025-01-01 00:00:00+00'::timestamptz + (i % 4) * interval '1 hour'
+  from generate_series(1, 5000) i;
+copy conv to :'filename' with (format 'jsonlines');
+create table conv_in (like conv);
+copy conv_in from :'filename' with (format 'jsonlines');
+select count(*) from ((select * from conv except all select * from conv_in)
+  union all (select * from conv_in except all select * from conv)) s;
+copy conv_in from stdin with (format 'jsonlines');
+{"id": 1, "d": 1}
+{"id": 2, "d": 10}
+\.
+
+-- per-phase statistics (timings vary, so they are not reported)
+\set filename :abs_builddir '/results/jsonlines_stats.data'
+copy (select i, 'v' || i as t from generate_series(1, 100) i) to :'filename' with (format 'jsonlines', stats true, stats_timing false);
+copy test_in from stdin with (format 'jsonlines', stats true, stats_timing false);
+{"i": 1, "t": "a"}
+\.
+
+drop extension pg_custom_copy_formats;
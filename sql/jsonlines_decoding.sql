@@ -0,0 +1,29 @@
+create table jl_cdc (id int primary key, name text, payload jsonb);
+
+select 'init' from pg_create_logical_replication_slot('jl_slot', 'pg_custom_copy_formats');
+
+begin;
+insert into jl_cdc values (1, 'a', '{"k": [1, 2]}'), (2, 'b "quoted"', null);
+commit;
+update jl_cdc set name = 'c' where id = 1;
+update jl_cdc set id = 3 where id = 2;
+delete from jl_cdc where id = 1;
+alter table jl_cdc replica identity full;
+alter table jl_cdc add column flag bool;
+update jl_cdc set flag = true where id = 3;
+truncate jl_cdc;
+
+select regexp_split_to_table(rtrim(data, E'\n'), E'\n')
+  from pg_logical_slot_get_changes('jl_slot', null, null,
+                                   'include-xids', 'false', 'include-lsn', 'false');
+
+-- a transaction is written as one message unless it exceeds batch-size
+insert into jl_cdc select i, 'n' || i from generate_series(1, 10) i;
+select count(*) from pg_logical_slot_peek_changes('jl_slot', null, null);
+select count(*) from pg_logical_slot_get_changes('jl_slot', null, null, 'batch-size', '100');
+
+-- error cases
+select * from pg_logical_slot_get_changes('jl_slot', null, null, 'batch-size', '0');
+select * from pg_logical_slot_get_changes('jl_slot', null, null, 'nosuchopt', 'x');
+
+select pg_drop_replication_slot('jl_slot');
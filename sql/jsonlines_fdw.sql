@@ -0,0 +1,67 @@
+create extension pg_custom_copy_formats;
+
+\getenv abs_builddir PG_ABS_BUILDDIR
+\set filename :abs_builddir '/results/jsonlines_fdw.data'
+
+create table src (id int, name text, tags jsonb);
+insert into src
+  select i, 'name' || i, jsonb_build_array(i, i * 2)
+  from generate_series(1, 100) i;
+copy src to :'filename' with (format 'jsonlines');
+
+create server jsonlines_server foreign data wrapper jsonlines_fdw;
+create foreign table ft (id int, name text, tags jsonb)
+  server jsonlines_server options (filename :'filename');
+
+select count(*) from ft;
+select * from ft where id <= 3 order by id;
+select sum(id), max(name) from ft;
+
+create foreign table ft_nested (id int, first_tag int)
+  server jsonlines_server
+  options (filename :'filename', column_paths 'first_tag=$.tags[0]');
+select * from ft_nested where id between 5 and 6 order by id;
+
+-- the defaults of the columns not queried are not evaluated
+create sequence ft_seq;
+create foreign table ft_default (id int, name text default nextval('ft_seq'))
+  server jsonlines_server options (filename :'filename');
+select count(*), max(id) from ft_default;
+select last_value, is_called from ft_seq;
+drop foreign table ft_default;
+drop sequence ft_seq;
+
+-- the extra keys don't depend on the columns queried
+\set extras_file :abs_builddir '/results/jsonlines_fdw_extras.data'
+copy (select i as id, 'k' || i as kind, i * 10 as x from generate_series(1, 3) i)
+  to :'extras_file' with (format 'jsonlines');
+create foreign table ft_extra (id int, kind text, attrs jsonb)
+  server jsonlines_server
+  options (filename :'extras_file', extra_keys_column 'attrs');
+select attrs from ft_extra;
+select id, attrs from ft_extra where kind = 'k2';
+
+-- parallel scan of a file larger than a chunk
+\set big_file :abs_builddir '/results/jsonlines_fdw_big.data'
+copy (select i as id, repeat('x', 100) as pad from generate_series(1, 100000) i)
+  to :'big_file' with (format 'jsonlines');
+create foreign table ft_big (id int, pad text)
+  server jsonlines_server options (filename :'big_file');
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+explain (costs off) select count(*), sum(id) from ft_big;
+select count(*), sum(id), min(id), max(id) from ft_big;
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+drop foreign table ft_extra, ft_big;
+
+-- error cases
+create foreign table ft_err (id int) server jsonlines_server;
+create foreign table ft_err (id int) server jsonlines_server
+  options (filename :'filename', delimiter ',');
+
+drop extension pg_custom_copy_formats cascade;
@@ -0,0 +1,46 @@
+create extension pg_custom_copy_formats;
+
+\getenv abs_builddir PG_ABS_BUILDDIR
+\set filename :abs_builddir '/results/jsonlines_funcs.data'
+
+create type jl_row as (id int, name text, score numeric, tags text[]);
+
+select * from jsonlines_to_record('{"id": 1, "name": "alice", "score": 1.5, "tags": "{a,b}"}', null::jl_row);
+select * from jsonlines_to_record('{"name": "bob", "unknown": true}', null::jl_row);
+select jsonlines_to_record(line, null::jl_row)
+  from (values ('{"id": 2}'), ('{"id": 3, "score": -1}')) v(line);
+
+create table jl_src (id int, name text, score numeric);
+insert into jl_src values (1, 'a', 0.5), (2, 'b', null), (3, null, 10);
+copy jl_src to :'filename' with (format 'jsonlines');
+
+create table jl_dst (like jl_src);
+insert into jl_dst select * from jsonlines_read(:'filename', null::jl_dst);
+select * from jl_dst order by id;
+select count(*) from jsonlines_read(null, null::jl_dst);
+
+-- jsonlines_agg
+select replace(jsonlines_agg(t order by id), E'\n', '|') from jl_src t;
+select jsonlines_agg(t order by id) = string_agg(row_to_json(t)::text || E'\n', '' order by id)
+  from jl_src t;
+select jsonlines_agg(t) from jl_src t where id > 10;
+select id % 2 as odd, replace(jsonlines_agg(row(id, name) order by id), E'\n', '|')
+  from jl_src group by 1 order by 1;
+
+create table jl_big as
+  select i as id, 'name' || i as name, i * 0.5 as score from generate_series(1, 10000) i;
+analyze jl_big;
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+select length(jsonlines_agg(t)) = (select sum(length(row_to_json(t)::text) + 1) from jl_big t)
+  from jl_big t;
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+
+-- error cases
+select jsonlines_to_record('[1, 2]', null::jl_row);
+select jsonlines_to_record('{"id": 1}', 1);
@@ -0,0 +1,37 @@
+-- the worker is not running, so load the batches by hand
+\getenv abs_builddir PG_ABS_BUILDDIR
+\set good_file :abs_builddir '/results/jsonlines_ingest_good.data'
+\set bad_file :abs_builddir '/results/jsonlines_ingest_bad.data'
+
+create table ing (id int, name text);
+insert into jsonlines_ingest_sources values (:'good_file', 'ing'), (:'bad_file', 'ing');
+
+create table ing_src (id int, name text);
+insert into ing_src values (1, 'a'), (2, 'b');
+copy ing_src to :'good_file' with (format 'jsonlines');
+select jsonlines_ingest_batch(:'good_file', :'good_file');
+select jsonlines_ingest_batch(:'good_file', :'good_file');
+select * from ing order by id;
+select read_offset, done, error from jsonlines_ingest_files where file_path = :'good_file';
+select file_dev is not null and file_ino is not null as identified
+  from jsonlines_ingest_files where file_path = :'good_file';
+
+-- appended lines are loaded from the recorded offset
+insert into ing_src values (3, 'c');
+copy ing_src to :'good_file' with (format 'jsonlines');
+select jsonlines_ingest_batch(:'good_file', :'good_file');
+select jsonlines_ingest_batch(:'good_file', :'good_file');
+select * from ing order by id;
+select read_offset, done, error from jsonlines_ingest_files where file_path = :'good_file';
+
+-- a failed batch is rolled back, and the file is skipped afterwards
+copy (values ('{"id": 4, "name": "d"}'), ('{"id": "x", "name": "e"}')) to :'bad_file';
+select jsonlines_ingest_batch(:'bad_file', :'bad_file');
+select jsonlines_ingest_batch(:'bad_file', :'bad_file');
+select * from ing order by id;
+select read_offset, done, error from jsonlines_ingest_files where file_path = :'bad_file';
+
+select jsonlines_ingest_batch('nosuch', :'good_file');
+
+delete from jsonlines_ingest_sources;
+drop table ing, ing_src;
@@ -0,0 +1,37 @@
+load 'pg_custom_copy_formats';
+
+set timezone = 'UTC';
+
+create table cpu (measurement text, host text, region text, usage float8,
+                  idle int, ok bool, note text, time timestamptz, extra jsonb);
+
+copy cpu from stdin with (format 'lineprotocol', extra_keys_column 'extra');
+cpu,host=server01,region=us-west usage=0.64,idle=3i 1700000000000000000
+# comment line
+
+cpu,host=server\ 02,dc=eu usage=1.5,ok=true,note="say \"hi\"",load=2i 1700000001500000000
+\.
+
+select * from cpu order by time;
+
+copy cpu (measurement, usage, time) from stdin with (format 'lineprotocol', precision 's');
+mem usage=42 1700000002
+\.
+
+select measurement, usage, time from cpu where measurement = 'mem';
+
+-- lines whose values can't be converted are skipped
+copy cpu (measurement, usage, idle, time) from stdin with (format 'lineprotocol', precision 's', on_error ignore, log_verbosity verbose);
+disk usage=1,idle=2i 1700000003
+disk usage=abc 1700000004
+disk usage=2,idle=99999999999i 1700000005
+\.
+
+select measurement, usage, idle, time from cpu where measurement = 'disk';
+
+-- error cases
+copy cpu from stdin with (format 'lineprotocol', precision 'h');
+copy cpu from stdin with (format 'lineprotocol', extra_keys_column 'note');
+copy cpu (measurement, usage, time) from stdin with (format 'lineprotocol', precision 's');
+mem usage=1 1700000006 junk
+\.
@@ -0,0 +1,25 @@
+load 'pg_custom_copy_formats';
+
+create table logs (level text, msg text, dur text, status int, cached bool,
+                   extra jsonb);
+
+copy logs from stdin with (format 'logfmt', extra_keys_column 'extra');
+level=info msg="request done" dur=12ms status=200 cached
+level=warn msg="slow \"query\"" dur=1.5s status= path=/api/v1?x=1
+
+level=error msg=failed	user=alice retry
+\.
+
+select * from logs order by level;
+
+-- lines whose values can't be converted are skipped
+copy logs (level, status) from stdin with (format 'logfmt', on_error ignore, log_verbosity verbose);
+level=debug status=204
+level=debug status=ok
+\.
+
+select level, status from logs where level = 'debug';
+
+-- error cases
+copy logs from stdin with (format 'logfmt', extra_keys_column 'msg');
+copy logs from stdin with (format 'logfmt', extra_keys_column 'nosuch');
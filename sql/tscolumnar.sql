@@ -0,0 +1,36 @@
+load 'pg_custom_copy_formats';
+
+\getenv abs_builddir PG_ABS_BUILDDIR
+\set filename :abs_builddir '/results/tscolumnar.data'
+
+create table metrics (ts timestamptz, series_id int, value float8, label text);
+-- enough rows for several blocks, with the special float values
+insert into metrics
+  select '2025-01-01 00:00:00+00'::timestamptz + i * interval '10 seconds',
+         i % 7,
+         case when i % 997 = 0 then 'NaN'
+              when i % 991 = 0 then 'Infinity'
+              when i % 983 = 0 then '-Infinity'
+              when i % 977 = 0 then '-0'
+              else sin(i) * 100 end,
+         case when i % 5 = 0 then null else 'l' || i end
+  from generate_series(1, 20000) i;
+
+copy metrics to :'filename' with (format 'tscolumnar');
+
+create table metrics_in (like metrics);
+copy metrics_in from :'filename' with (format 'tscolumnar');
+
+select count(*) from metrics_in;
+(select * from metrics except select * from metrics_in)
+union all
+(select * from metrics_in except select * from metrics);
+
+-- equality doesn't tell -0 from 0
+select count(*) filter (where value::text = 'NaN') as nan,
+       count(*) filter (where value = 'Infinity') as inf,
+       count(*) filter (where value = '-Infinity') as ninf,
+       count(*) filter (where value::text = '-0') as negzero
+  from metrics_in;
+
+copy metrics_in from :'filename' with (format 'tscolumnar', on_error ignore);
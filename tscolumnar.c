@@ -0,0 +1,1169 @@
+/*--------------------------------------------------------------------------
+ *
+ * tscolumnar.c
+ *		Columnar time-series format support for COPY command.
+ *
+ * Rows are buffered into blocks and each column of a block is encoded
+ * separately:
+ *
+ * - timestamp, timestamptz and date columns use delta-of-delta encoding,
+ *   written as zigzag varints.
+ * - int2, int4 and int8 columns are delta encoded from the previous value
+ *   and written as zigzag varints.
+ * - float4 and float8 columns use the XOR encoding of the Gorilla paper.
+ * - All other columns are written as their text representation.
+ *
+ * The stream layout is:
+ *
+ *	header:	"PGTSCOL\0", uint16 version, uint16 ncolumns, uint8 kind * ncolumns
+ *	block:	uint32 nrows, then per column: uint32 length, uint8 has_nulls,
+ *			[null bitmap], encoded non-null values
+ *	trailer: uint32 0
+ *
+ * Multi-byte integers in the header and block framing are in network byte
+ * order.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		tscolumnar.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "commands/copyapi.h"
+#include "commands/copystate.h"
+#include "port/pg_bitutils.h"
+#include "port/pg_bswap.h"
+#include "utils/date.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+
+#include "pg_custom_copy_formats.h"
+
+#define TSCOL_MAGIC			"PGTSCOL"	/* 8 bytes including the terminator */
+#define TSCOL_MAGIC_LEN		8
+#define TSCOL_VERSION		1
+
+/*
+ * Budget for the per-block working set of the column arrays.  This is kept
+ * well below common L2 cache sizes (256kB and up) so that the column arrays
+ * and the encoded output of one block stay cache resident while a block is
+ * encoded or decoded.
+ */
+#define TSCOL_L2_BUDGET			(128 * 1024)
+#define TSCOL_MIN_BLOCK_ROWS	128
+#define TSCOL_MAX_BLOCK_ROWS	8192
+
+/* Per-column encodings */
+typedef enum TsColumnarKind
+{
+	TSCOL_KIND_DOD = 1,			/* delta-of-delta zigzag varints */
+	TSCOL_KIND_VARINT = 2,		/* delta zigzag varints */
+	TSCOL_KIND_GORILLA = 3,		/* Gorilla XOR bit packing */
+	TSCOL_KIND_TEXT = 4,		/* length-prefixed text representation */
+} TsColumnarKind;
+
+/*
+ * Per-column block buffer, used by both directions.
+ */
+typedef struct TsColumnarColumn
+{
+	int			attnum;
+	Oid			typid;
+	int32		typmod;
+	TsColumnarKind kind;
+
+	/* Null flags of the current block */
+	bool	   *nulls;
+	bool		has_nulls;
+
+	/* Values of the current block for the numeric encodings */
+	int64	   *vals;
+
+	/*
+	 * Encoded payload.  COPY TO appends text values here as rows arrive, and
+	 * COPY FROM reads the payload of the current block into it.
+	 */
+	StringInfoData payload;
+
+	/* COPY FROM only: start of each text value within payload */
+	int		   *offsets;
+} TsColumnarColumn;
+
+typedef struct CopyToStateTsColumnar
+{
+	CopyToStateData base;
+
+	int			ncolumns;
+	TsColumnarColumn *columns;
+
+	int			block_rows;		/* rows per block */
+	int			nrows;			/* rows buffered in the current block */
+
+	StringInfoData encbuf;		/* encoded column of the block being flushed */
+
+	CopyStats  *stats;			/* NULL unless collecting statistics */
+} CopyToStateTsColumnar;
+
+typedef struct CopyFromStateTsColumnar
+{
+	CopyFromStateData base;
+
+	int			ncolumns;
+	TsColumnarColumn *columns;
+
+	int			capacity;		/* allocated length of the column arrays */
+	int			nrows;			/* rows in the current block */
+	int			currow;			/* next row to return */
+	bool		reached_eof;
+
+	CopyStats  *stats;			/* NULL unless collecting statistics */
+} CopyFromStateTsColumnar;
+
+/*
+ * Bit-level writer and reader for the Gorilla encoding.  Bits are packed
+ * MSB first.
+ */
+typedef struct TsBitWriter
+{
+	StringInfo	out;
+	uint64		acc;
+	int			nbits;			/* number of pending bits in acc, < 8 */
+} TsBitWriter;
+
+typedef struct TsBitReader
+{
+	const unsigned char *ptr;
+	const unsigned char *end;
+	uint64		acc;
+	int			nbits;			/* number of valid bits in acc */
+} TsBitReader;
+
+static TsColumnarKind
+tscolumnar_kind_for_type(Oid typid)
+{
+	switch (typid)
+	{
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		case DATEOID:
+			return TSCOL_KIND_DOD;
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			return TSCOL_KIND_VARINT;
+		case FLOAT4OID:
+		case FLOAT8OID:
+			return TSCOL_KIND_GORILLA;
+		default:
+			return TSCOL_KIND_TEXT;
+	}
+}
+
+static void
+tscolumnar_corrupted(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_DATA_CORRUPTED),
+			 errmsg("corrupted tscolumnar data")));
+}
+
+/*
+ * Varint helpers
+ */
+
+static inline uint64
+zigzag_encode(int64 v)
+{
+	return ((uint64) v << 1) ^ (uint64) (v >> 63);
+}
+
+static inline int64
+zigzag_decode(uint64 v)
+{
+	return (int64) (v >> 1) ^ -((int64) (v & 1));
+}
+
+static inline void
+append_varint(StringInfo buf, uint64 v)
+{
+	unsigned char tmp[10];
+	int			len = 0;
+
+	while (v >= 0x80)
+	{
+		tmp[len++] = (unsigned char) (v | 0x80);
+		v >>= 7;
+	}
+	tmp[len++] = (unsigned char) v;
+
+	appendBinaryStringInfo(buf, tmp, len);
+}
+
+static inline uint64
+read_varint(const unsigned char **ptr, const unsigned char *end)
+{
+	uint64		v = 0;
+	int			shift = 0;
+
+	while (*ptr < end)
+	{
+		unsigned char b = *(*ptr)++;
+
+		v |= (uint64) (b & 0x7F) << shift;
+		if ((b & 0x80) == 0)
+			return v;
+
+		shift += 7;
+		if (shift > 63)
+			break;
+	}
+
+	tscolumnar_corrupted();
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Bit writer/reader helpers
+ */
+
+static inline void
+bitwriter_put(TsBitWriter *w, uint64 value, int nbits)
+{
+	Assert(nbits <= 32);
+
+	if (nbits == 0)
+		return;
+
+	w->acc = (w->acc << nbits) | (value & ((UINT64CONST(1) << nbits) - 1));
+	w->nbits += nbits;
+
+	while (w->nbits >= 8)
+	{
+		w->nbits -= 8;
+		appendStringInfoCharMacro(w->out, (char) (w->acc >> w->nbits));
+	}
+}
+
+static inline void
+bitwriter_write(TsBitWriter *w, uint64 value, int nbits)
+{
+	if (nbits > 32)
+	{
+		bitwriter_put(w, value >> 32, nbits - 32);
+		bitwriter_put(w, value, 32);
+	}
+	else
+		bitwriter_put(w, value, nbits);
+}
+
+static inline void
+bitwriter_finish(TsBitWriter *w)
+{
+	if (w->nbits > 0)
+		bitwriter_put(w, 0, 8 - w->nbits);
+}
+
+static inline uint64
+bitreader_get(TsBitReader *r, int nbits)
+{
+	Assert(nbits <= 32);
+
+	if (nbits == 0)
+		return 0;
+
+	while (r->nbits < nbits)
+	{
+		if (r->ptr >= r->end)
+			tscolumnar_corrupted();
+		r->acc = (r->acc << 8) | *r->ptr++;
+		r->nbits += 8;
+	}
+
+	r->nbits -= nbits;
+	return (r->acc >> r->nbits) & ((UINT64CONST(1) << nbits) - 1);
+}
+
+static inline uint64
+bitreader_read(TsBitReader *r, int nbits)
+{
+	if (nbits > 32)
+	{
+		uint64		hi = bitreader_get(r, nbits - 32);
+
+		return (hi << 32) | bitreader_get(r, 32);
+	}
+
+	return bitreader_get(r, nbits);
+}
+
+/*
+ * Column encoders.  Each appends the encoded non-null values of the block to
+ * 'out'.
+ */
+
+static void
+encode_dod(TsColumnarColumn *col, int nrows, StringInfo out)
+{
+	int64		prev = 0;
+	int64		prev_delta = 0;
+	int			n = 0;
+
+	for (int i = 0; i < nrows; i++)
+	{
+		int64		v;
+
+		if (col->nulls[i])
+			continue;
+
+		v = col->vals[i];
+		if (n == 0)
+			append_varint(out, zigzag_encode(v));
+		else
+		{
+			int64		delta = v - prev;
+
+			append_varint(out, zigzag_encode(delta - prev_delta));
+			prev_delta = delta;
+		}
+		prev = v;
+		n++;
+	}
+}
+
+static void
+encode_varint(TsColumnarColumn *col, int nrows, StringInfo out)
+{
+	int64		prev = 0;
+
+	for (int i = 0; i < nrows; i++)
+	{
+		if (col->nulls[i])
+			continue;
+
+		append_varint(out, zigzag_encode(col->vals[i] - prev));
+		prev = col->vals[i];
+	}
+}
+
+static void
+encode_gorilla(TsColumnarColumn *col, int nrows, StringInfo out)
+{
+	TsBitWriter w = {out, 0, 0};
+	uint64		prev = 0;
+	int			prev_lead = -1;
+	int			prev_trail = 0;
+	bool		first = true;
+
+	for (int i = 0; i < nrows; i++)
+	{
+		uint64		v;
+		uint64		x;
+		int			lead;
+		int			trail;
+
+		if (col->nulls[i])
+			continue;
+
+		v = (uint64) col->vals[i];
+
+		if (first)
+		{
+			bitwriter_write(&w, v, 64);
+			prev = v;
+			first = false;
+			continue;
+		}
+
+		x = v ^ prev;
+		prev = v;
+
+		if (x == 0)
+		{
+			bitwriter_put(&w, 0, 1);
+			continue;
+		}
+
+		lead = 63 - pg_leftmost_one_pos64(x);
+		trail = pg_rightmost_one_pos64(x);
+
+		/* The leading zero count is stored in 5 bits */
+		if (lead > 31)
+			lead = 31;
+
+		if (prev_lead >= 0 && lead >= prev_lead && trail >= prev_trail)
+		{
+			/* Meaningful bits fit into the previous window */
+			bitwriter_put(&w, 2, 2);
+			bitwriter_write(&w, x >> prev_trail, 64 - prev_lead - prev_trail);
+		}
+		else
+		{
+			int			sig = 64 - lead - trail;
+
+			bitwriter_put(&w, 3, 2);
+			bitwriter_put(&w, lead, 5);
+			bitwriter_put(&w, sig - 1, 6);
+			bitwriter_write(&w, x >> trail, sig);
+
+			prev_lead = lead;
+			prev_trail = trail;
+		}
+	}
+
+	bitwriter_finish(&w);
+}
+
+/*
+ * Column decoders.  Each fills col->vals (or col->offsets) for the non-null
+ * rows of the block from the encoded bytes in [ptr, end).
+ */
+
+static void
+decode_dod(TsColumnarColumn *col, int nrows, const unsigned char *ptr,
+		   const unsigned char *end)
+{
+	int64		prev = 0;
+	int64		prev_delta = 0;
+	int			n = 0;
+
+	for (int i = 0; i < nrows; i++)
+	{
+		if (col->nulls[i])
+			continue;
+
+		if (n == 0)
+			prev = zigzag_decode(read_varint(&ptr, end));
+		else
+		{
+			prev_delta += zigzag_decode(read_varint(&ptr, end));
+			prev += prev_delta;
+		}
+		col->vals[i] = prev;
+		n++;
+	}
+}
+
+static void
+decode_varint(TsColumnarColumn *col, int nrows, const unsigned char *ptr,
+			  const unsigned char *end)
+{
+	int64		prev = 0;
+
+	for (int i = 0; i < nrows; i++)
+	{
+		if (col->nulls[i])
+			continue;
+
+		prev += zigzag_decode(read_varint(&ptr, end));
+		col->vals[i] = prev;
+	}
+}
+
+static void
+decode_gorilla(TsColumnarColumn *col, int nrows, const unsigned char *ptr,
+			   const unsigned char *end)
+{
+	TsBitReader r = {ptr, end, 0, 0};
+	uint64		prev = 0;
+	int			prev_lead = 0;
+	int			prev_trail = 0;
+	bool		first = true;
+
+	for (int i = 0; i < nrows; i++)
+	{
+		if (col->nulls[i])
+			continue;
+
+		if (first)
+		{
+			prev = bitreader_read(&r, 64);
+			first = false;
+		}
+		else if (bitreader_get(&r, 1) != 0)
+		{
+			if (bitreader_get(&r, 1) != 0)
+			{
+				int			sig;
+
+				prev_lead = (int) bitreader_get(&r, 5);
+				sig = (int) bitreader_get(&r, 6) + 1;
+				if (prev_lead + sig > 64)
+					tscolumnar_corrupted();
+				prev_trail = 64 - prev_lead - sig;
+			}
+
+			prev ^= bitreader_read(&r, 64 - prev_lead - prev_trail) << prev_trail;
+		}
+
+		col->vals[i] = (int64) prev;
+	}
+}
+
+static void
+decode_text(TsColumnarColumn *col, int nrows, const unsigned char *ptr,
+			const unsigned char *end)
+{
+	const unsigned char *start = (const unsigned char *) col->payload.data;
+
+	for (int i = 0; i < nrows; i++)
+	{
+		uint64		len;
+
+		if (col->nulls[i])
+			continue;
+
+		/* The length includes the terminating zero byte */
+		len = read_varint(&ptr, end);
+		if (len == 0 || len > (uint64) (end - ptr) || ptr[len - 1] != '\0')
+			tscolumnar_corrupted();
+
+		col->offsets[i] = ptr - start;
+		ptr += len;
+	}
+}
+
+/*
+ * COPY TO routines
+ */
+
+/*
+ * Send the data in fe_msgbuf, counting it in the statistics.
+ */
+static void
+TsColumnarSend(CopyToStateTsColumnar *cstate)
+{
+	CopyStatsPhase prev = CopyStatsSwitch(cstate->stats, COPY_PHASE_WRITE);
+
+	CopyStatsAddBytes(cstate->stats, COPY_PHASE_WRITE,
+					  cstate->base.fe_msgbuf->len);
+	CopyToFlushData((CopyToState) cstate);
+	(void) CopyStatsSwitch(cstate->stats, prev);
+}
+
+static void
+TsColumnarCopyToOutFunc(CopyToState cstate, Oid atttypid, FmgrInfo *finfo)
+{
+	Oid			func_oid;
+	bool		is_varlena;
+
+	getTypeOutputInfo(atttypid, &func_oid, &is_varlena);
+	fmgr_info(func_oid, finfo);
+}
+
+static void
+TsColumnarCopyToStart(CopyToState ccstate, TupleDesc tupDesc)
+{
+	CopyToStateTsColumnar *cstate = (CopyToStateTsColumnar *) ccstate;
+	ListCell   *lc;
+	int			i = 0;
+	int			row_width;
+	uint16		u16;
+
+	if (CopyStatsSharedEnabled())
+		cstate->stats = CopyStatsCreate();
+
+	cstate->ncolumns = list_length(cstate->base.attnumlist);
+	cstate->columns = palloc0(sizeof(TsColumnarColumn) * Max(cstate->ncolumns, 1));
+
+	/*
+	 * Size blocks so that the column arrays of one block fit in the cache
+	 * budget.
+	 */
+	row_width = Max(cstate->ncolumns, 1) * (sizeof(int64) + sizeof(bool));
+	cstate->block_rows = TSCOL_L2_BUDGET / row_width;
+	cstate->block_rows = Max(cstate->block_rows, TSCOL_MIN_BLOCK_ROWS);
+	cstate->block_rows = Min(cstate->block_rows, TSCOL_MAX_BLOCK_ROWS);
+	cstate->nrows = 0;
+
+	foreach(lc, cstate->base.attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+		TsColumnarColumn *col = &cstate->columns[i++];
+
+		col->attnum = attnum;
+		col->typid = att->atttypid;
+		col->typmod = att->atttypmod;
+		col->kind = tscolumnar_kind_for_type(att->atttypid);
+		col->nulls = palloc(sizeof(bool) * cstate->block_rows);
+		col->has_nulls = false;
+
+		if (col->kind == TSCOL_KIND_TEXT)
+			initStringInfo(&col->payload);
+		else
+			col->vals = palloc(sizeof(int64) * cstate->block_rows);
+	}
+
+	initStringInfo(&cstate->encbuf);
+
+	/* Write the stream header */
+	appendBinaryStringInfo(cstate->base.fe_msgbuf, TSCOL_MAGIC, TSCOL_MAGIC_LEN);
+	u16 = pg_hton16(TSCOL_VERSION);
+	appendBinaryStringInfo(cstate->base.fe_msgbuf, &u16, sizeof(u16));
+	u16 = pg_hton16((uint16) cstate->ncolumns);
+	appendBinaryStringInfo(cstate->base.fe_msgbuf, &u16, sizeof(u16));
+	for (i = 0; i < cstate->ncolumns; i++)
+		appendStringInfoCharMacro(cstate->base.fe_msgbuf,
+								  (char) cstate->columns[i].kind);
+
+	TsColumnarSend(cstate);
+}
+
+/*
+ * Encode and send the buffered block.
+ */
+static void
+TsColumnarFlushBlock(CopyToStateTsColumnar *cstate)
+{
+	StringInfo	msgbuf = cstate->base.fe_msgbuf;
+	uint32		u32;
+
+	if (cstate->nrows == 0)
+		return;
+
+	u32 = pg_hton32((uint32) cstate->nrows);
+	appendBinaryStringInfo(msgbuf, &u32, sizeof(u32));
+
+	for (int i = 0; i < cstate->ncolumns; i++)
+	{
+		TsColumnarColumn *col = &cstate->columns[i];
+		StringInfo	enc = &cstate->encbuf;
+
+		resetStringInfo(enc);
+		appendStringInfoCharMacro(enc, (char) col->has_nulls);
+
+		if (col->has_nulls)
+		{
+			int			nbytes = (cstate->nrows + 7) / 8;
+			int			start = enc->len;
+
+			enlargeStringInfo(enc, nbytes);
+			memset(enc->data + start, 0, nbytes);
+			for (int row = 0; row < cstate->nrows; row++)
+			{
+				if (col->nulls[row])
+					enc->data[start + row / 8] |= (1 << (row % 8));
+			}
+			enc->len += nbytes;
+		}
+
+		switch (col->kind)
+		{
+			case TSCOL_KIND_DOD:
+				encode_dod(col, cstate->nrows, enc);
+				break;
+			case TSCOL_KIND_VARINT:
+				encode_varint(col, cstate->nrows, enc);
+				break;
+			case TSCOL_KIND_GORILLA:
+				encode_gorilla(col, cstate->nrows, enc);
+				break;
+			case TSCOL_KIND_TEXT:
+				appendBinaryStringInfo(enc, col->payload.data, col->payload.len);
+				resetStringInfo(&col->payload);
+				break;
+		}
+
+		u32 = pg_hton32((uint32) enc->len);
+		appendBinaryStringInfo(msgbuf, &u32, sizeof(u32));
+		appendBinaryStringInfo(msgbuf, enc->data, enc->len);
+
+		col->has_nulls = false;
+	}
+
+	TsColumnarSend(cstate);
+	cstate->nrows = 0;
+}
+
+static void
+TsColumnarCopyToOneRow(CopyToState ccstate, TupleTableSlot *slot)
+{
+	CopyToStateTsColumnar *cstate = (CopyToStateTsColumnar *) ccstate;
+	int			row = cstate->nrows;
+
+	CopyStatsBeginRow(cstate->stats);
+	(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_ENCODE);
+
+	slot_getallattrs(slot);
+
+	for (int i = 0; i < cstate->ncolumns; i++)
+	{
+		TsColumnarColumn *col = &cstate->columns[i];
+		Datum		value = slot->tts_values[col->attnum - 1];
+		bool		isnull = slot->tts_isnull[col->attnum - 1];
+
+		col->nulls[row] = isnull;
+		if (isnull)
+		{
+			col->has_nulls = true;
+			continue;
+		}
+
+		switch (col->typid)
+		{
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+			case INT8OID:
+				col->vals[row] = DatumGetInt64(value);
+				break;
+			case DATEOID:
+				col->vals[row] = (int64) DatumGetDateADT(value);
+				break;
+			case INT2OID:
+				col->vals[row] = (int64) DatumGetInt16(value);
+				break;
+			case INT4OID:
+				col->vals[row] = (int64) DatumGetInt32(value);
+				break;
+			case FLOAT4OID:
+				{
+					double		d = (double) DatumGetFloat4(value);
+
+					memcpy(&col->vals[row], &d, sizeof(double));
+					break;
+				}
+			case FLOAT8OID:
+				{
+					double		d = DatumGetFloat8(value);
+
+					memcpy(&col->vals[row], &d, sizeof(double));
+					break;
+				}
+			default:
+				{
+					char	   *str;
+					size_t		len;
+
+					Assert(col->kind == TSCOL_KIND_TEXT);
+
+					str = OutputFunctionCall(&cstate->base.out_functions[col->attnum - 1],
+											 value);
+					len = strlen(str);
+					append_varint(&col->payload, (uint64) len + 1);
+					appendBinaryStringInfo(&col->payload, str, len + 1);
+					break;
+				}
+		}
+	}
+
+	if (++cstate->nrows >= cstate->block_rows)
+		TsColumnarFlushBlock(cstate);
+
+	if (cstate->stats != NULL)
+	{
+		cstate->stats->rows++;
+		(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_OTHER);
+	}
+}
+
+static void
+TsColumnarCopyToEnd(CopyToState ccstate)
+{
+	CopyToStateTsColumnar *cstate = (CopyToStateTsColumnar *) ccstate;
+	uint32		u32 = 0;
+
+	if (cstate->stats != NULL)
+		CopyStatsEndRows(cstate->stats);
+
+	TsColumnarFlushBlock(cstate);
+
+	/* Write the trailer */
+	appendBinaryStringInfo(cstate->base.fe_msgbuf, &u32, sizeof(u32));
+	TsColumnarSend(cstate);
+
+	if (cstate->stats != NULL)
+		CopyStatsFinish(cstate->stats, "tscolumnar", false, false);
+}
+
+/*
+ * COPY FROM routines
+ */
+
+/*
+ * Read exactly 'len' bytes.  Returns false if the source is exhausted before
+ * any byte is read; reaching the end in the middle of the data is an error.
+ */
+static bool
+TsColumnarReadExact(CopyFromStateTsColumnar *cstate, void *dest, int len)
+{
+	int			nread = 0;
+	CopyStatsPhase prev = CopyStatsSwitch(cstate->stats, COPY_PHASE_READ);
+
+	while (nread < len)
+	{
+		int			n;
+
+		n = CopyFromGetData((CopyFromState) cstate, (char *) dest + nread,
+							1, len - nread);
+		if (n <= 0)
+		{
+			if (nread == 0)
+			{
+				(void) CopyStatsSwitch(cstate->stats, prev);
+				return false;
+			}
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("unexpected EOF in tscolumnar data")));
+		}
+		nread += n;
+	}
+
+	cstate->base.bytes_processed += len;
+	CopyStatsAddBytes(cstate->stats, COPY_PHASE_READ, len);
+	(void) CopyStatsSwitch(cstate->stats, prev);
+
+	return true;
+}
+
+static void
+TsColumnarCopyFromInFunc(CopyFromState cstate, Oid atttypid, FmgrInfo *finfo,
+						 Oid *typioparam)
+{
+	Oid			func_oid;
+
+	getTypeInputInfo(atttypid, &func_oid, typioparam);
+	fmgr_info(func_oid, finfo);
+}
+
+static void
+TsColumnarCopyFromStart(CopyFromState ccstate, TupleDesc tupDesc)
+{
+	CopyFromStateTsColumnar *cstate = (CopyFromStateTsColumnar *) ccstate;
+	char		magic[TSCOL_MAGIC_LEN];
+	uint16		u16;
+	ListCell   *lc;
+	int			i = 0;
+
+	/* Like the binary format, the values can't be skipped one row at a time */
+	if (cstate->base.opts.on_error != COPY_ON_ERROR_STOP)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("only ON_ERROR STOP is allowed in tscolumnar format")));
+
+	if (CopyStatsSharedEnabled())
+		cstate->stats = CopyStatsCreate();
+
+	if (!TsColumnarReadExact(cstate, magic, TSCOL_MAGIC_LEN) ||
+		memcmp(magic, TSCOL_MAGIC, TSCOL_MAGIC_LEN) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("tscolumnar file signature not recognized")));
+
+	if (!TsColumnarReadExact(cstate, &u16, sizeof(u16)) ||
+		pg_ntoh16(u16) != TSCOL_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("unsupported tscolumnar version")));
+
+	if (!TsColumnarReadExact(cstate, &u16, sizeof(u16)))
+		tscolumnar_corrupted();
+
+	cstate->ncolumns = list_length(cstate->base.attnumlist);
+	if (pg_ntoh16(u16) != cstate->ncolumns)
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("tscolumnar data has %d columns, but %d columns are expected",
+						pg_ntoh16(u16), cstate->ncolumns)));
+
+	cstate->columns = palloc0(sizeof(TsColumnarColumn) * Max(cstate->ncolumns, 1));
+	cstate->capacity = TSCOL_MIN_BLOCK_ROWS;
+
+	foreach(lc, cstate->base.attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+		TsColumnarColumn *col = &cstate->columns[i++];
+		unsigned char kind;
+
+		if (!TsColumnarReadExact(cstate, &kind, 1))
+			tscolumnar_corrupted();
+
+		col->attnum = attnum;
+		col->typid = att->atttypid;
+		col->typmod = att->atttypmod;
+		col->kind = tscolumnar_kind_for_type(att->atttypid);
+
+		if ((TsColumnarKind) kind != col->kind)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("tscolumnar encoding of column \"%s\" does not match its data type",
+							NameStr(att->attname))));
+
+		col->nulls = palloc(sizeof(bool) * cstate->capacity);
+		if (col->kind == TSCOL_KIND_TEXT)
+			col->offsets = palloc(sizeof(int) * cstate->capacity);
+		else
+			col->vals = palloc(sizeof(int64) * cstate->capacity);
+		initStringInfo(&col->payload);
+	}
+
+	cstate->nrows = cstate->currow = 0;
+	cstate->reached_eof = false;
+}
+
+/*
+ * Read and decode the next block.  Returns false at the end of data.
+ */
+static bool
+TsColumnarReadBlock(CopyFromStateTsColumnar *cstate)
+{
+	uint32		u32;
+	int			nrows;
+
+	if (cstate->reached_eof || !TsColumnarReadExact(cstate, &u32, sizeof(u32)))
+		return false;
+
+	nrows = (int) pg_ntoh32(u32);
+	if (nrows == 0)
+	{
+		cstate->reached_eof = true;
+		return false;
+	}
+
+	if (nrows < 0 || nrows > TSCOL_MAX_BLOCK_ROWS)
+		tscolumnar_corrupted();
+
+	if (nrows > cstate->capacity)
+	{
+		cstate->capacity = nrows;
+		for (int i = 0; i < cstate->ncolumns; i++)
+		{
+			TsColumnarColumn *col = &cstate->columns[i];
+
+			col->nulls = repalloc(col->nulls, sizeof(bool) * nrows);
+			if (col->kind == TSCOL_KIND_TEXT)
+				col->offsets = repalloc(col->offsets, sizeof(int) * nrows);
+			else
+				col->vals = repalloc(col->vals, sizeof(int64) * nrows);
+		}
+	}
+
+	for (int i = 0; i < cstate->ncolumns; i++)
+	{
+		TsColumnarColumn *col = &cstate->columns[i];
+		const unsigned char *ptr;
+		const unsigned char *end;
+		int			len;
+
+		if (!TsColumnarReadExact(cstate, &u32, sizeof(u32)))
+			tscolumnar_corrupted();
+
+		len = (int) pg_ntoh32(u32);
+		if (len < 1)
+			tscolumnar_corrupted();
+
+		resetStringInfo(&col->payload);
+		enlargeStringInfo(&col->payload, len);
+		if (!TsColumnarReadExact(cstate, col->payload.data, len))
+			tscolumnar_corrupted();
+		col->payload.len = len;
+
+		ptr = (const unsigned char *) col->payload.data;
+		end = ptr + len;
+
+		col->has_nulls = (*ptr++ != 0);
+		if (col->has_nulls)
+		{
+			int			nbytes = (nrows + 7) / 8;
+
+			if (end - ptr < nbytes)
+				tscolumnar_corrupted();
+
+			for (int row = 0; row < nrows; row++)
+				col->nulls[row] = (ptr[row / 8] & (1 << (row % 8))) != 0;
+			ptr += nbytes;
+		}
+		else
+			memset(col->nulls, 0, sizeof(bool) * nrows);
+
+		switch (col->kind)
+		{
+			case TSCOL_KIND_DOD:
+				decode_dod(col, nrows, ptr, end);
+				break;
+			case TSCOL_KIND_VARINT:
+				decode_varint(col, nrows, ptr, end);
+				break;
+			case TSCOL_KIND_GORILLA:
+				decode_gorilla(col, nrows, ptr, end);
+				break;
+			case TSCOL_KIND_TEXT:
+				decode_text(col, nrows, ptr, end);
+				break;
+		}
+	}
+
+	cstate->nrows = nrows;
+	cstate->currow = 0;
+
+	return true;
+}
+
+static Datum
+TsColumnarGetDatum(CopyFromStateTsColumnar *cstate, TsColumnarColumn *col,
+				   int row)
+{
+	int64		v = col->vals[row];
+
+	switch (col->typid)
+	{
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		case INT8OID:
+			return Int64GetDatum(v);
+		case DATEOID:
+			if (v < PG_INT32_MIN || v > PG_INT32_MAX)
+				tscolumnar_corrupted();
+			return DateADTGetDatum((DateADT) v);
+		case INT2OID:
+			if (v < PG_INT16_MIN || v > PG_INT16_MAX)
+				ereport(ERROR,
+						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+						 errmsg("smallint out of range")));
+			return Int16GetDatum((int16) v);
+		case INT4OID:
+			if (v < PG_INT32_MIN || v > PG_INT32_MAX)
+				ereport(ERROR,
+						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+						 errmsg("integer out of range")));
+			return Int32GetDatum((int32) v);
+		case FLOAT4OID:
+			{
+				double		d;
+
+				memcpy(&d, &v, sizeof(double));
+				return Float4GetDatum((float4) d);
+			}
+		case FLOAT8OID:
+			{
+				double		d;
+
+				memcpy(&d, &v, sizeof(double));
+				return Float8GetDatum(d);
+			}
+		default:
+			elog(ERROR, "unexpected type %u for tscolumnar column", col->typid);
+	}
+
+	return (Datum) 0;			/* keep compiler quiet */
+}
+
+static bool
+TsColumnarCopyFromOneRow(CopyFromState ccstate, ExprContext *econtext, Datum *values,
+						 bool *nulls, CopyFromRowInfo *rowinfo)
+{
+	CopyFromStateTsColumnar *cstate = (CopyFromStateTsColumnar *) ccstate;
+	int			row;
+
+	CopyStatsBeginRow(cstate->stats);
+
+	if (cstate->currow >= cstate->nrows)
+	{
+		(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_PARSE);
+		if (!TsColumnarReadBlock(cstate))
+			return false;
+	}
+
+	(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_CONVERT);
+
+	row = cstate->currow++;
+
+	for (int i = 0; i < cstate->ncolumns; i++)
+	{
+		TsColumnarColumn *col = &cstate->columns[i];
+		int			m = col->attnum - 1;
+
+		if (col->nulls[row])
+		{
+			nulls[m] = true;
+			continue;
+		}
+
+		nulls[m] = false;
+
+		if (col->kind == TSCOL_KIND_TEXT)
+		{
+			char	   *str = col->payload.data + col->offsets[row];
+
+			values[m] = InputFunctionCall(&cstate->base.in_functions[m],
+										  str,
+										  cstate->base.typioparams[m],
+										  col->typmod);
+		}
+		else
+			values[m] = TsColumnarGetDatum(cstate, col, row);
+	}
+
+	cstate->base.cur_lineno++;
+
+	/* Set output parameters */
+	if (rowinfo)
+	{
+		rowinfo->lineno = cstate->base.cur_lineno;
+		rowinfo->tuplen = 0;
+	}
+
+	if (cstate->stats != NULL)
+	{
+		cstate->stats->rows++;
+		(void) CopyStatsSwitch(cstate->stats, COPY_PHASE_OTHER);
+	}
+
+	return true;
+}
+
+static void
+TsColumnarCopyFromEnd(CopyFromState ccstate)
+{
+	CopyFromStateTsColumnar *cstate = (CopyFromStateTsColumnar *) ccstate;
+
+	if (cstate->stats != NULL)
+	{
+		CopyStatsEndRows(cstate->stats);
+		cstate->stats->errors = cstate->base.num_errors;
+		CopyStatsFinish(cstate->stats, "tscolumnar", true, false);
+	}
+}
+
+static Size
+TsColumnarCopyToEstimateSpace(void)
+{
+	return sizeof(CopyToStateTsColumnar);
+}
+
+static Size
+TsColumnarCopyFromEstimateSpace(void)
+{
+	return sizeof(CopyFromStateTsColumnar);
+}
+
+static const CopyToRoutine TsColumnarCopyToRoutine = {
+	.CopyToEstimateStateSpace = TsColumnarCopyToEstimateSpace,
+	.CopyToProcessOneOption = NULL,
+	.CopyToOutFunc = TsColumnarCopyToOutFunc,
+	.CopyToStart = TsColumnarCopyToStart,
+	.CopyToOneRow = TsColumnarCopyToOneRow,
+	.CopyToEnd = TsColumnarCopyToEnd,
+};
+
+static const CopyFromRoutine TsColumnarCopyFromRoutine = {
+	.CopyFromEstimateStateSpace = TsColumnarCopyFromEstimateSpace,
+	.CopyFromProcessOneOption = NULL,
+	.CopyFromInFunc = TsColumnarCopyFromInFunc,
+	.CopyFromStart = TsColumnarCopyFromStart,
+	.CopyFromOneRow = TsColumnarCopyFromOneRow,
+	.CopyFromEnd = TsColumnarCopyFromEnd,
+};
+
+void
+RegisterTsColumnarCopyFormat(void)
+{
+	RegisterCopyCustomFormat("tscolumnar",
+							 &TsColumnarCopyFromRoutine,
+							 &TsColumnarCopyToRoutine);
+}